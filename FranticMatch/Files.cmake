@@ -7,6 +7,7 @@
 # Header files
 set (GLOB FRANTICMATCH_HEADERFILES
 	FranticMatch/FranticMatch.hpp
+	FranticMatch/LevelPack.hpp
 	)
 
 include_directories("FranticMatch")
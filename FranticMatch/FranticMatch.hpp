@@ -2,9 +2,35 @@
 #pragma once
 
 #include <vector>
+#include <memory_resource>
 #include <span>
 #include <random>
 #include <set>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <bit>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <optional>
+#include <concepts>
+#include <ranges>
+#include <iterator>
+#include <limits>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<mdspan>)
+#include <mdspan>
+#endif
 
 #define FRANTICMATCH_API
 
@@ -80,710 +106,6498 @@ namespace FranticMatch
 	};
 
 	using MisketPosition = Vector2D<Scalar>;
-	using MisketMatchGroup = std::vector<MisketPosition>;
+	using MisketMatchGroup = std::pmr::vector<MisketPosition>;
+	using MisketMatchGroups = std::pmr::vector<MisketMatchGroup>;
 
 	/// <summary>
-	/// A class representing a 2D match table.
-	/// It is a grid of elements that is used for matching games.
+	/// Minimum match length that stands for the one the table was made with.
+	/// It is the default of every minMatchLength override.
 	/// </summary>
-	/// <typeparam name="T">The type of the elements in the table. Aka. Misket</typeparam>
-	/// <typeparam name="S">The scalar type for the vectors (positions etc.)</typeparam>
-	template <typename T, typename S = Scalar>
-	class FRANTICMATCH_API Table
-	{
-	public:
-		/// <summary>
-		/// Match directions for the table.
-		/// This is used to determine the directions in which matches can be made.
-		/// 
-		/// Default is horizontal and vertical.
-		/// </summary>
-		struct MatchDirections
-		{
-			bool horizontal = true;
-			bool vertical = true;
-			bool diagonal = false;
-		};
-
-	private:
-		S rowCount;
-		S columnCount;
-		std::vector<T> data;
+	inline constexpr unsigned int TABLE_MATCH_LENGTH = std::numeric_limits<unsigned int>::max();
 
-		/// <summary>
-		/// Possible values for the Miskets.
-		/// This is used to randomise the table.
-		/// </summary>
-		std::vector<T> possibleValues;
+	/// <summary>
+	/// A position packed into a single linear cell index (row * columnCount + column).
+	/// It is 2-4 times smaller than a Vector2D, for big match results and move histories.
+	/// The column count of the table is needed to convert it back to row and column.
+	/// </summary>
+	/// <typeparam name="I">Unsigned index type. Must hold the cell count of the table.</typeparam>
+	template <std::unsigned_integral I = std::uint32_t>
+	struct PackedPosition
+	{
+		using IndexType = I;
 
-		// Can be unsigned, but for the setup, let's keep it signed
-		/// <summary>
-		/// Minimum length of a match.
-		/// </summary>
-		int minimumMatchLength;
+		I index = 0;
 
-		inline static std::random_device randomDevice;
-		inline static std::mt19937 randomGen = std::mt19937(randomDevice());
+		constexpr PackedPosition() = default;
 
-	public:
-		Table()
-			: rowCount(0u), columnCount(0u), data(), possibleValues(), minimumMatchLength(3u)
+		constexpr explicit PackedPosition(I i)
+			: index(i)
 		{
 		}
 
-		Table(S rows, S columns, const std::vector<T>& possibleValues, int minMatchLength = 3u)
-			: rowCount(rows), columnCount(columns), data(rows* columns), possibleValues(possibleValues), minimumMatchLength(minMatchLength)
+		template <typename S>
+		constexpr PackedPosition(S row, S column, S columnCount)
+			: index(static_cast<I>(row * columnCount + column))
 		{
 		}
 
-		Table(MisketPosition size, const std::vector<T>& possibleValues, int minMatchLength = 3u)
-			: rowCount(size.row), columnCount(size.column), data(size.row* size.column), possibleValues(possibleValues), minimumMatchLength(minMatchLength)
+		template <typename S>
+		constexpr S Row(S columnCount) const
 		{
+			return static_cast<S>(index / static_cast<I>(columnCount));
 		}
 
-		T& operator()(S row, S column)
+		template <typename S>
+		constexpr S Column(S columnCount) const
 		{
-			return data[Index(row, column)];
+			return static_cast<S>(index % static_cast<I>(columnCount));
 		}
 
-		T& operator()(MisketPosition pos)
+		template <typename S>
+		constexpr Vector2D<S> ToVector2D(S columnCount) const
 		{
-			return data[Index(pos)];
+			return Vector2D<S>(Row(columnCount), Column(columnCount));
 		}
 
-		const T& operator()(S row, S column) const
+		constexpr auto operator<=>(const PackedPosition&) const = default;
+	};
+
+	/// <summary>
+	/// Is P a PackedPosition?
+	/// </summary>
+	template <typename P>
+	concept PackedPositionType = std::same_as<P, PackedPosition<typename P::IndexType>>;
+
+	using PackedMisketPosition = PackedPosition<std::uint32_t>;
+	using ShortPackedMisketPosition = PackedPosition<std::uint16_t>;
+
+	template <std::unsigned_integral I = std::uint32_t>
+	using PackedMisketMatchGroup = std::pmr::vector<PackedPosition<I>>;
+
+	template <std::unsigned_integral I = std::uint32_t>
+	using PackedMisketMatchGroups = std::pmr::vector<PackedMisketMatchGroup<I>>;
+
+	/// <summary>
+	/// A view of every stride-th element from a first one, e.g. a column or a diagonal of a table.
+	/// Elements are read in place, nothing is copied.
+	/// </summary>
+	/// <typeparam name="T">Type of the elements, const for a read-only view.</typeparam>
+	template <typename T>
+	class StridedSpan : public std::ranges::view_interface<StridedSpan<T>>
+	{
+	public:
+		class Iterator
 		{
-			return data[Index(row, column)];
-		}
+		public:
+			using iterator_concept = std::random_access_iterator_tag;
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = std::remove_cv_t<T>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = T*;
+			using reference = T&;
 
-		const T& operator()(MisketPosition pos) const
+			Iterator() = default;
+
+			Iterator(T* first, std::ptrdiff_t stride, std::ptrdiff_t index)
+				: first(first), stride(stride), index(index)
+			{
+			}
+
+			reference operator*() const
+			{
+				return first[index * stride];
+			}
+
+			pointer operator->() const
+			{
+				return &first[index * stride];
+			}
+
+			reference operator[](difference_type n) const
+			{
+				return first[(index + n) * stride];
+			}
+
+			Iterator& operator++()
+			{
+				++index;
+				return *this;
+			}
+
+			Iterator operator++(int)
+			{
+				Iterator previous = *this;
+				++index;
+				return previous;
+			}
+
+			Iterator& operator--()
+			{
+				--index;
+				return *this;
+			}
+
+			Iterator operator--(int)
+			{
+				Iterator previous = *this;
+				--index;
+				return previous;
+			}
+
+			Iterator& operator+=(difference_type n)
+			{
+				index += n;
+				return *this;
+			}
+
+			Iterator& operator-=(difference_type n)
+			{
+				index -= n;
+				return *this;
+			}
+
+			friend Iterator operator+(Iterator it, difference_type n)
+			{
+				return it += n;
+			}
+
+			friend Iterator operator+(difference_type n, Iterator it)
+			{
+				return it += n;
+			}
+
+			friend Iterator operator-(Iterator it, difference_type n)
+			{
+				return it -= n;
+			}
+
+			friend difference_type operator-(const Iterator& a, const Iterator& b)
+			{
+				return a.index - b.index;
+			}
+
+			friend bool operator==(const Iterator& a, const Iterator& b)
+			{
+				return a.index == b.index;
+			}
+
+			friend auto operator<=>(const Iterator& a, const Iterator& b)
+			{
+				return a.index <=> b.index;
+			}
+
+		private:
+			// Stepping only moves the index, so a stride of 0 or 1 element past the end is never formed
+			T* first = nullptr;
+			std::ptrdiff_t stride = 1;
+			std::ptrdiff_t index = 0;
+		};
+
+		StridedSpan() = default;
+
+		/// <param name="first">The first element.</param>
+		/// <param name="count">Number of elements.</param>
+		/// <param name="stride">Distance between two elements, in elements.</param>
+		StridedSpan(T* first, size_t count, std::ptrdiff_t stride)
+			: first(first), count(count), stride(stride)
 		{
-			return data[Index(pos)];
 		}
 
-		T* operator[](S row)
+		Iterator begin() const
 		{
-			return &data[row * columnCount];
+			return Iterator(first, stride, 0);
 		}
 
-		const T* operator[](S row) const
+		Iterator end() const
 		{
-			return &data[row * columnCount];
+			return Iterator(first, stride, static_cast<std::ptrdiff_t>(count));
 		}
 
-		/// <summary>
-		/// Get a misket from the table.
-		/// </summary>
-		/// <param name="row">The row index.</param>
-		/// <param name="column">The column index.</param>
-		/// <returns>The misket at the specified row and column.</returns>
-		const T& Get(S row, S column) const
+		std::ptrdiff_t GetStride() const
 		{
-			return data[Index(row, column)];
+			return stride;
 		}
 
+	private:
+		T* first = nullptr;
+		size_t count = 0;
+		std::ptrdiff_t stride = 1;
+	};
+
+	/// <summary>
+	/// Special miskets are created by bigger matches.
+	/// When they are cleared, they clear more miskets with them.
+	/// </summary>
+	enum class SpecialMisket : std::uint8_t
+	{
+		None = 0,
+
 		/// <summary>
-		/// Get a misket from the table.
+		/// Clears its whole row. Created by a vertical match of 4.
 		/// </summary>
-		/// <param name="pos">The position of the misket.</param>
-		/// <returns>The misket at the specified position.</returns>
-		const T& Get(MisketPosition pos) const
-		{
-			return data[Index(pos)];
-		}
+		RowClearer,
 
 		/// <summary>
-		/// Set a misket in the table.
+		/// Clears its whole column. Created by a horizontal match of 4.
 		/// </summary>
-		/// <param name="row">The row index.</param>
-		/// <param name="column">The column index.</param>
-		/// <param name="value">The new misket value to set.</param>
-		void Set(S row, S column, const T& value)
-		{
-			data[Index(row, column)] = value;
-		}
+		ColumnClearer,
 
 		/// <summary>
-		/// Set a misket in the table.
+		/// Clears the 3x3 area around it. Created by L and T shaped matches.
 		/// </summary>
-		/// <param name="pos">The position of the misket.</param>
-		/// <param name="value">The new misket value to set.</param>
-		void Set(MisketPosition pos, const T& value)
-		{
-			data[Index(pos)] = value;
-		}
+		Bomb,
 
 		/// <summary>
-		/// Get the number of rows in the table.
+		/// Clears every misket of its colour. Created by a match of 5 or more.
 		/// </summary>
-		/// <returns>The number of rows in the table.</returns>
-		S GetRowCount() const
-		{
-			return rowCount;
-		}
+		ColourBomb,
+	};
 
+	/// <summary>
+	/// Result of resolving one cascade step.
+	/// </summary>
+	struct ClearResult
+	{
 		/// <summary>
-		/// Get the number of columns in the table.
+		/// Every cleared position, including the ones cleared by special miskets.
 		/// </summary>
-		/// <returns>The number of columns in the table.</returns>
-		S GetColumnCount() const
-		{
-			return columnCount;
-		}
+		MisketMatchGroup cleared;
 
 		/// <summary>
-		/// Get a row of the table.
+		/// Special miskets created by the matches, with their positions before the collapse.
 		/// </summary>
-		/// <param name="rowIndex">The index of the row to get.</param>
-		/// <returns>A row of the table.</returns>
-		std::vector<T> GetRow(S rowIndex) const
-		{
-			S start = rowIndex * columnCount;
-			return std::vector<T>(data.begin() + start, data.begin() + start + columnCount);
-		}
+		std::pmr::vector<std::pair<MisketPosition, SpecialMisket>> created;
 
 		/// <summary>
-		/// Get a row of the table as a span.
+		/// Number of special miskets that went off.
 		/// </summary>
-		/// <param name="rowIndex">The index of the row to get.</param>
-		/// <returns>A row of the table as a span.</returns>
-		std::span<T> GetRowSpan(S rowIndex)
-		{
-			return { &data[rowIndex * columnCount], columnCount };
-		}
+		Scalar triggeredCount = 0;
+	};
+
+	/// <summary>
+	/// Adjusts the spawn weights after a cascade step, e.g. to make a colour rarer after a big cascade.
+	/// Gets the result of the step and the weights, in the order of the possible values, to change in place.
+	/// Returns true if it changed them.
+	/// </summary>
+	using SpawnWeightController = std::function<bool(const ClearResult&, std::span<double>)>;
 
+	/// <summary>
+	/// Kinds of board events, in the order they happen in a move.
+	/// </summary>
+	enum class BoardEventType : std::uint8_t
+	{
 		/// <summary>
-		/// Get a row of the table as a span.
+		/// Two miskets were swapped, from and to.
 		/// </summary>
-		/// <param name="rowIndex">The index of the row to get.</param>
-		/// <returns>A row of the table as a span.</returns>
-		std::span<const T> GetRowSpan(S rowIndex) const
-		{
-			return { &data[rowIndex * columnCount], columnCount };
-		}
+		Swapped,
 
 		/// <summary>
-		/// Get a column of the table.
+		/// A misket is part of the match group at index group.
 		/// </summary>
-		/// <param name="columnIndex">The index of the column to get.</param>
-		/// <returns>A column of the table.</returns>
-		std::vector<T> GetColumn(S columnIndex) const
-		{
-			std::vector<T> column;
-			column.reserve(rowCount);
-			for (S i = 0; i < rowCount; ++i)
-			{
-				column.emplace_back(data[Index(i, columnIndex)]);
-			}
-			return column;
-		}
+		Matched,
 
 		/// <summary>
-		/// Set a row in the table.
+		/// A misket was popped.
 		/// </summary>
-		/// <param name="rowIndex">The index of the row to set.</param>
-		/// <param name="row">The misket values to set in the row.</param>
-		void SetRow(S rowIndex, const std::vector<T>& row)
-		{
-			S start = rowIndex * columnCount;
-			for (S i = 0; i < columnCount; ++i)
-			{
-				data[start + i] = row[i];
-			}
-		}
+		Cleared,
 
 		/// <summary>
-		/// Set a column in the table.
+		/// A misket fell from one cell to another.
 		/// </summary>
-		/// <param name="columnIndex">The index of the column to set.</param>
-		/// <param name="column">The misket values to set in the column.</param>
-		void SetColumn(S columnIndex, const std::vector<T>& column)
-		{
-			for (S i = 0; i < rowCount; ++i)
-			{
-				data[Index(i, columnIndex)] = column[i];
-			}
-		}
+		Moved,
 
 		/// <summary>
-		/// Resize the table to the specified number of rows and columns.
+		/// A new misket was spawned.
 		/// </summary>
-		/// <param name="newRows">Target number of rows.</param>
-		/// <param name="newColumns">Target number of columns.</param>
-		void Resize(S newRows, S newColumns)
-		{
-			rowCount = newRows;
-			columnCount = newColumns;
-			data.resize(newRows * newColumns);
-		}
+		Spawned,
+	};
+
+	/// <summary>
+	/// A single change on the board.
+	/// </summary>
+	struct BoardEvent
+	{
+		BoardEventType type;
 
 		/// <summary>
-		/// Clear the table and reset its size to 0.
+		/// The cell of the event. The first misket for Swapped, the source for Moved.
 		/// </summary>
-		void Clear()
-		{
-			data.clear();
-			rowCount = 0u;
-			columnCount = 0u;
-		}
+		MisketPosition from;
 
 		/// <summary>
-		/// Check if the specified row and column are within the bounds of the table.
+		/// The second misket for Swapped, the destination for Moved. Same as from for the others.
 		/// </summary>
-		/// <param name="row">The row index.</param>
-		/// <param name="column">The column index.</param>
-		/// <returns>True if the row and column are within bounds, false otherwise.</returns>
-		bool CheckBounds(S row, S column) const
-		{
-			return row < rowCount && column < columnCount;
-		}
+		MisketPosition to;
 
 		/// <summary>
-		/// Check if the specified position is within the bounds of the table.
+		/// Index of the match group for Matched, -1 for the others.
 		/// </summary>
-		/// <param name="pos">The position to check.</param>
-		/// <returns>True if the position is within bounds, false otherwise.</returns>
+		Scalar group = -1;
+	};
+
+	/// <summary>
+	/// Receives the events of one table operation.
+	/// The span points into the table and is valid until its next operation.
+	/// </summary>
+	using BoardEventObserver = std::function<void(std::span<const BoardEvent>)>;
+
+	/// <summary>
+	/// Projects a misket to the key it is matched by. Two miskets match if their keys are equal.
+	/// </summary>
+	/// <remarks>
+	/// The projection is a type, not a value, so it is compiled into the match kernels.
+	/// e.g. a colour-blind rule that matches every shade of a colour is a projection to the colour.
+	/// </remarks>
+	template <typename P, typename T>
+	concept MatchKeyProjection = std::default_initializable<P> && std::regular_invocable<const P&, const T&>
+		&& std::equality_comparable<std::remove_cvref_t<std::invoke_result_t<const P&, const T&>>>;
+
+	/// <summary>
+	/// Payload type of tables without a payload. No payload array is stored.
+	/// </summary>
+	struct NoPayload
+	{
+	};
+
+	/// <summary>
+	/// The match direction an axis of a topology belongs to.
+	/// Axes are switched on and off with the table's MatchDirections.
+	/// </summary>
+	enum class MatchAxis
+	{
+		Horizontal,
+		Vertical,
+		Diagonal,
+	};
+
+	/// <summary>
+	/// Describes how the cells of a table, stored row by row, are connected.
+	/// </summary>
+	/// <remarks>
+	/// A topology has axisCount axes. Step moves a position one cell along an axis, forwards or backwards,
+	/// and returns false when it leaves the board. Stepping back must undo stepping forward.
+	/// Lines are the chains of cells along an axis. They end at the edges, or go round in a cycle.
+	/// Miskets are swapped with their neighbours along the axes.
+	/// </remarks>
+	template <typename P>
+	concept GridTopology = requires(Scalar rows, Scalar columns, Scalar& row, Scalar& column, int axis, bool forward)
+	{
+		{ P::isSquare } -> std::convertible_to<bool>;
+		{ P::axisCount } -> std::convertible_to<int>;
+		{ P::axes[0] } -> std::convertible_to<MatchAxis>;
+		{ P::Step(rows, columns, row, column, axis, forward) } -> std::same_as<bool>;
+	};
+
+	/// <summary>
+	/// The square grid. Lines are the rows, the columns and both kinds of diagonal.
+	/// </summary>
+	/// <remarks>
+	/// Tables on the square grid scan their lines with fixed strides, so no neighbour or line tables are built.
+	/// </remarks>
+	struct SquareTopology
+	{
+		static constexpr bool isSquare = true;
+		static constexpr int axisCount = 4;
+		static constexpr MatchAxis axes[axisCount] = { MatchAxis::Horizontal, MatchAxis::Vertical, MatchAxis::Diagonal, MatchAxis::Diagonal };
+
+		// Forward step of every axis: right, down, down-right and down-left
+		static constexpr int steps[axisCount][2] = { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, -1 } };
+
+		template <typename S>
+		static bool Step(S rows, S columns, S& row, S& column, int axis, bool forward)
+		{
+			const S sign = forward ? 1 : -1;
+			row += sign * steps[axis][0];
+			column += sign * steps[axis][1];
+			return row >= 0 && row < rows && column >= 0 && column < columns;
+		}
+	};
+
+	/// <summary>
+	/// The square grid wrapped round at its edges. Every line is a cycle.
+	/// </summary>
+	struct TorusTopology
+	{
+		static constexpr bool isSquare = false;
+		static constexpr int axisCount = SquareTopology::axisCount;
+		static constexpr MatchAxis axes[axisCount] = { MatchAxis::Horizontal, MatchAxis::Vertical, MatchAxis::Diagonal, MatchAxis::Diagonal };
+
+		template <typename S>
+		static bool Step(S rows, S columns, S& row, S& column, int axis, bool forward)
+		{
+			const S sign = forward ? 1 : -1;
+			row = (row + sign * SquareTopology::steps[axis][0] + rows) % rows;
+			column = (column + sign * SquareTopology::steps[axis][1] + columns) % columns;
+			return true;
+		}
+	};
+
+	/// <summary>
+	/// Pointy-top hexagons in rows, with the odd rows pushed half a cell to the right.
+	/// </summary>
+	/// <remarks>
+	/// Lines run along the rows, and down-right and down-left along the slanted axes.
+	/// The rows are the horizontal direction, both slanted axes are the vertical one.
+	/// </remarks>
+	struct HexTopology
+	{
+		static constexpr bool isSquare = false;
+		static constexpr int axisCount = 3;
+		static constexpr MatchAxis axes[axisCount] = { MatchAxis::Horizontal, MatchAxis::Vertical, MatchAxis::Vertical };
+
+		template <typename S>
+		static bool Step(S rows, S columns, S& row, S& column, int axis, bool forward)
+		{
+			if (axis == 0)
+			{
+				column += forward ? 1 : -1;
+			}
+			else if (forward)
+			{
+				// Down-right keeps the column from an even row, down-left keeps it from an odd one
+				column += axis == 1 ? (row & 1) : (row & 1) - 1;
+				row += 1;
+			}
+			else
+			{
+				row -= 1;
+				column -= axis == 1 ? (row & 1) : (row & 1) - 1;
+			}
+
+			return row >= 0 && row < rows && column >= 0 && column < columns;
+		}
+	};
+
+	/// <summary>
+	/// A work-stealing thread pool.
+	/// </summary>
+	/// <remarks>
+	/// Every worker has its own task queue. Workers take their newest task first
+	/// and steal the oldest task of another worker when their own queue is empty.
+	/// Tasks submitted from a worker go to that worker's queue.
+	/// </remarks>
+	class FRANTICMATCH_API ThreadPool
+	{
+	private:
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<std::jthread> threads;
+
+		/// <summary>
+		/// Tasks waiting in a queue.
+		/// </summary>
+		std::atomic<size_t> queuedCount = 0;
+
+		/// <summary>
+		/// Tasks submitted but not finished yet.
+		/// </summary>
+		std::atomic<size_t> pendingCount = 0;
+
+		/// <summary>
+		/// Round-robin queue for tasks submitted from outside the pool.
+		/// </summary>
+		std::atomic<size_t> nextQueue = 0;
+
+		std::mutex sleepMutex;
+		std::condition_variable wakeCondition;
+		std::condition_variable idleCondition;
+		bool stopping = false;
+
+		inline static thread_local const ThreadPool* currentPool = nullptr;
+		inline static thread_local size_t currentWorker = 0;
+
+	public:
+		/// <summary>
+		/// Start the workers.
+		/// </summary>
+		/// <param name="threadCount">Number of worker threads. 0 uses every hardware thread.</param>
+		explicit ThreadPool(unsigned int threadCount = 0)
+		{
+			if (threadCount == 0)
+			{
+				threadCount = std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			workers.reserve(threadCount);
+			for (unsigned int i = 0; i < threadCount; ++i)
+			{
+				workers.emplace_back(std::make_unique<Worker>());
+			}
+
+			threads.reserve(threadCount);
+			for (unsigned int i = 0; i < threadCount; ++i)
+			{
+				threads.emplace_back([this, i]() { Run(i); });
+			}
+		}
+
+		/// <summary>
+		/// Finish every queued task, then stop the workers.
+		/// </summary>
+		~ThreadPool()
+		{
+			{
+				std::lock_guard lock(sleepMutex);
+				stopping = true;
+			}
+			wakeCondition.notify_all();
+			threads.clear();
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/// <summary>
+		/// Queue a task.
+		/// </summary>
+		/// <param name="task">The task to run on a worker.</param>
+		void Submit(std::function<void()> task)
+		{
+			const size_t index = currentPool == this ? currentWorker : nextQueue++ % workers.size();
+
+			pendingCount++;
+			{
+				std::lock_guard lock(workers[index]->mutex);
+				workers[index]->tasks.emplace_back(std::move(task));
+			}
+			queuedCount++;
+
+			// Taking the lock makes sure a worker going to sleep sees the new task
+			{
+				std::lock_guard lock(sleepMutex);
+			}
+			wakeCondition.notify_one();
+		}
+
+		/// <summary>
+		/// Wait until every submitted task is finished, including the ones they submit.
+		/// </summary>
+		void WaitIdle()
+		{
+			std::unique_lock lock(sleepMutex);
+			idleCondition.wait(lock, [this]() { return pendingCount == 0; });
+		}
+
+		/// <summary>
+		/// Get the number of worker threads.
+		/// </summary>
+		/// <returns>The number of worker threads.</returns>
+		unsigned int GetThreadCount() const
+		{
+			return static_cast<unsigned int>(workers.size());
+		}
+
+		/// <summary>
+		/// Run a function for every index in [0, count) on the workers and the calling thread, and wait for all of them.
+		/// </summary>
+		/// <remarks>
+		/// The calling thread runs indices too, so it never waits on workers that are busy with other tasks,
+		/// and a task of this pool can call it without running out of workers.
+		/// </remarks>
+		/// <param name="count">Number of indices.</param>
+		/// <param name="function">Called once with every index.</param>
+		template <typename Function>
+		void ParallelFor(size_t count, Function&& function)
+		{
+			if (count == 0)
+				return;
+
+			struct Progress
+			{
+				std::atomic<size_t> next = 0;
+				std::atomic<size_t> done = 0;
+			};
+			const auto progress = std::make_shared<Progress>();
+
+			// A helper that starts after the last index is taken only touches the progress it shares,
+			// so the function can live on the stack of the caller
+			const auto work = [progress, count, &function]()
+			{
+				for (size_t index = progress->next++; index < count; index = progress->next++)
+				{
+					function(index);
+
+					if (++progress->done == count)
+						progress->done.notify_all();
+				}
+			};
+
+			const size_t helperCount = std::min(count - 1, workers.size());
+			for (size_t i = 0; i < helperCount; ++i)
+			{
+				Submit(work);
+			}
+
+			work();
+
+			for (size_t done = progress->done; done < count; done = progress->done)
+			{
+				progress->done.wait(done);
+			}
+		}
+
+		/// <summary>
+		/// Get the pool shared by the parallel kernels of the tables.
+		/// It is started on first use, with a worker per hardware thread.
+		/// </summary>
+		/// <returns>The shared pool.</returns>
+		static ThreadPool& GetShared()
+		{
+			static ThreadPool shared;
+			return shared;
+		}
+
+	private:
+		/// <summary>
+		/// Take the newest task of a worker, or steal the oldest task of another one.
+		/// </summary>
+		bool TryTake(size_t index, std::function<void()>& task)
+		{
+			{
+				Worker& own = *workers[index];
+				std::lock_guard lock(own.mutex);
+				if (!own.tasks.empty())
+				{
+					task = std::move(own.tasks.back());
+					own.tasks.pop_back();
+					return true;
+				}
+			}
+
+			for (size_t i = 1; i < workers.size(); ++i)
+			{
+				Worker& victim = *workers[(index + i) % workers.size()];
+				std::lock_guard lock(victim.mutex);
+				if (!victim.tasks.empty())
+				{
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		/// <summary>
+		/// Worker loop.
+		/// </summary>
+		void Run(size_t index)
+		{
+			currentPool = this;
+			currentWorker = index;
+
+			std::function<void()> task;
+			while (true)
+			{
+				if (TryTake(index, task))
+				{
+					queuedCount--;
+					task();
+					task = nullptr;
+
+					if (--pendingCount == 0)
+					{
+						std::lock_guard lock(sleepMutex);
+						idleCondition.notify_all();
+					}
+					continue;
+				}
+
+				std::unique_lock lock(sleepMutex);
+				wakeCondition.wait(lock, [this]() { return stopping || queuedCount > 0; });
+
+				if (stopping && queuedCount == 0)
+					return;
+			}
+		}
+	};
+
+	/// <summary>
+	/// A class representing a 2D match table.
+	/// It is a grid of elements that is used for matching games.
+	/// </summary>
+	/// <remarks>
+	/// Miskets are stored densely, and only they are read by the match kernels.
+	/// Data that doesn't take part in matching (IDs, animation state...) goes in the payload array next to them.
+	/// 
+	/// Matches and swaps follow the lines of the topology. Gravity, lanes and special miskets
+	/// work on the rows and columns the cells are stored in, on every topology.
+	/// </remarks>
+	/// <typeparam name="T">The type of the elements in the table. Aka. Misket</typeparam>
+	/// <typeparam name="S">The scalar type for the vectors (positions etc.)</typeparam>
+	/// <typeparam name="Key">Projection from a misket to the key it is matched by. See MatchKeyProjection.</typeparam>
+	/// <typeparam name="Payload">Per cell data that moves with the miskets. NoPayload for none.</typeparam>
+	/// <typeparam name="Topology">How the cells are connected into lines and neighbours. See GridTopology.</typeparam>
+	template <typename T, typename S = Scalar, MatchKeyProjection<T> Key = std::identity, typename Payload = NoPayload, GridTopology Topology = SquareTopology>
+	class FRANTICMATCH_API Table
+	{
+	public:
+		/// <summary>
+		/// The type miskets are matched by.
+		/// </summary>
+		using KeyType = std::remove_cvref_t<std::invoke_result_t<const Key&, const T&>>;
+
+		static constexpr bool hasPayload = !std::is_same_v<Payload, NoPayload>;
+
+		/// <summary>
+		/// Axes of the topology. Every cell has one swap slot per axis, see IsValidSwap.
+		/// </summary>
+		static constexpr int axisCount = Topology::axisCount;
+
+		/// <summary>
+		/// Match directions for the table.
+		/// This is used to determine the directions in which matches can be made.
+		/// 
+		/// Default is horizontal and vertical.
+		/// </summary>
+		struct MatchDirections
+		{
+			bool horizontal = true;
+			bool vertical = true;
+			bool diagonal = false;
+		};
+
+		/// <summary>
+		/// The direction miskets fall to when others are popped.
+		/// New miskets spawn from the opposite edge.
+		/// 
+		/// Default is down.
+		/// </summary>
+		enum class Gravity
+		{
+			Down,
+			Up,
+			Left,
+			Right,
+		};
+
+		/// <summary>
+		/// Where the miskets went in a collapse, for animating falls without diffing the board.
+		/// </summary>
+		/// <remarks>
+		/// Both lists are in compaction order: lane by lane for horizontal gravity,
+		/// and step by step away from the gravity edge, across all columns, for vertical gravity.
+		/// Within a lane, entries nearer the gravity edge come first.
+		/// </remarks>
+		struct CollapseMoves
+		{
+			struct Fall
+			{
+				PackedMisketPosition from;
+				PackedMisketPosition to;
+			};
+
+			struct Spawn
+			{
+				PackedMisketPosition to;
+				T value;
+			};
+
+			/// <summary>
+			/// Miskets that fell, from and to.
+			/// </summary>
+			std::pmr::vector<Fall> falls;
+
+			/// <summary>
+			/// New miskets and their values.
+			/// </summary>
+			std::pmr::vector<Spawn> spawns;
+		};
+
+		/// <summary>
+		/// The cells that differ between two boards, with their new contents. See Diff and ApplyPatch.
+		/// </summary>
+		struct BoardPatch
+		{
+			/// <summary>
+			/// Size of the board the patch leads to.
+			/// </summary>
+			S rowCount = 0;
+			S columnCount = 0;
+
+			/// <summary>
+			/// One bit per cell, in the same order as the board. Set for every changed cell.
+			/// </summary>
+			std::pmr::vector<std::uint64_t> changedMask;
+
+			/// <summary>
+			/// Changed cells, in ascending order.
+			/// </summary>
+			std::pmr::vector<S> indices;
+
+			/// <summary>
+			/// New misket, special misket and activity of every changed cell, in the order of indices.
+			/// </summary>
+			std::pmr::vector<T> values;
+			std::pmr::vector<SpecialMisket> specials;
+			std::pmr::vector<bool> active;
+
+			bool IsEmpty() const
+			{
+				return indices.empty();
+			}
+		};
+
+	private:
+		S rowCount;
+		S columnCount;
+		std::pmr::vector<T> data;
+
+		/// <summary>
+		/// Possible values for the Miskets.
+		/// This is used to randomise the table.
+		/// </summary>
+		std::pmr::vector<T> possibleValues;
+
+		// Can be unsigned, but for the setup, let's keep it signed
+		/// <summary>
+		/// Minimum length of a match.
+		/// </summary>
+		int minimumMatchLength;
+
+		/// <summary>
+		/// The direction miskets fall to when others are popped.
+		/// </summary>
+		Gravity gravity = Gravity::Down;
+
+		/// <summary>
+		/// One bit per cell, in the same order as data.
+		/// Inactive cells are holes in the board. They are never matched, moved or refilled.
+		/// </summary>
+		std::pmr::vector<std::uint64_t> activeMask;
+
+		/// <summary>
+		/// The activity bits again, line by line, so scans in every direction skip holes a mask word at a time.
+		/// Rows come first, in the same order as data, then the columns one after another,
+		/// then the diagonals, laid out by diagonalRowOffsets. Square grids only, kept in step with activeMask.
+		/// </summary>
+		std::pmr::vector<std::uint64_t> lineActiveMask;
+
+		/// <summary>
+		/// Where the diagonals go when they are laid out one after another, first the Top-Left to Bottom-Right ones,
+		/// numbered by column - row + rowCount - 1, then the Top-Right to Bottom-Left ones, numbered by row + column after the others.
+		/// The cell of a diagonal in row r is at diagonalRowOffsets[diagonal] + r.
+		/// </summary>
+		std::pmr::vector<S> diagonalRowOffsets;
+
+		/// <summary>
+		/// Special misket type of every cell, in the same order as data.
+		/// </summary>
+		std::pmr::vector<SpecialMisket> specials;
+
+		/// <summary>
+		/// Payload of every cell, in the same order as data. Empty without a payload type.
+		/// </summary>
+		std::pmr::vector<Payload> payloads;
+
+		/// <summary>
+		/// Pre-generated spawns, one queue of refillQueueLength miskets per lane. See PreviewRefills.
+		/// Made when the table is sized, and again when gravity changes the shape of the lanes,
+		/// so collapses never allocate.
+		/// </summary>
+		std::pmr::vector<T> refillQueues;
+
+		/// <summary>
+		/// Next unused misket of every lane's queue.
+		/// </summary>
+		std::pmr::vector<S> refillHeads;
+
+		S refillQueueLength = 0;
+
+		/// <summary>
+		/// Spawn weight of every possible value. Empty for uniform spawns.
+		/// </summary>
+		std::pmr::vector<double> spawnWeights;
+
+		/// <summary>
+		/// Walker's alias table of the spawn weights.
+		/// A draw picks a value uniformly and keeps it with probability aliasThresholds / 2^32, otherwise takes its alias.
+		/// </summary>
+		std::pmr::vector<std::uint64_t> aliasThresholds;
+		std::pmr::vector<std::uint32_t> aliasIndices;
+
+		/// <summary>
+		/// Called after every cascade step. See SetSpawnWeightController.
+		/// </summary>
+		SpawnWeightController spawnWeightController;
+
+		/// <summary>
+		/// Memory for temporaries and returned match groups.
+		/// Board storage uses the resource given to the constructor.
+		/// </summary>
+		std::pmr::memory_resource* scratchResource = std::pmr::get_default_resource();
+
+		/// <summary>
+		/// Live set of valid swaps, see EnableMoveTracking.
+		/// Changes only record the cells they touch; the set is brought up to date when it is read.
+		/// </summary>
+		struct MoveTracker
+		{
+			bool enabled = false;
+			unsigned int minMatchLength = 0;
+			MatchDirections matchDirections;
+
+			/// <summary>
+			/// Rebuild the whole set on the next read.
+			/// </summary>
+			bool allDirty = true;
+
+			/// <summary>
+			/// Cells changed since the last read.
+			/// </summary>
+			std::pmr::vector<S> dirtyCells;
+
+			/// <summary>
+			/// Valid swap slots, in no particular order. A slot is cellIndex * axisCount + axis, see IsValidSwap.
+			/// </summary>
+			std::pmr::vector<S> validSlots;
+
+			/// <summary>
+			/// Where every slot is in validSlots, -1 if the swap is not valid.
+			/// </summary>
+			std::pmr::vector<S> slotPositions;
+		};
+		mutable MoveTracker moveTracker;
+
+		/// <summary>
+		/// Lines written to since the last dirty scan, one bit per line. See FindDirtyMatchGroups.
+		/// Diagonals are numbered like in GetInPlaceLineDescriptors, each kind from 0.
+		/// </summary>
+		struct DirtyLines
+		{
+			std::pmr::vector<std::uint64_t> rows;
+			std::pmr::vector<std::uint64_t> columns;
+			std::pmr::vector<std::uint64_t> downRight;
+			std::pmr::vector<std::uint64_t> downLeft;
+
+			static bool Test(const std::pmr::vector<std::uint64_t>& lines, S line)
+			{
+				return (lines[line >> 6] >> (line & 63)) & 1u;
+			}
+
+			static void Set(std::pmr::vector<std::uint64_t>& lines, S line)
+			{
+				lines[line >> 6] |= std::uint64_t(1) << (line & 63);
+			}
+		};
+		mutable DirtyLines dirtyLines;
+
+		/// <summary>
+		/// A line of a topology, in TopologyTables::lineCells.
+		/// </summary>
+		struct TopologyLine
+		{
+			S start;
+			S length;
+			int axis;
+			bool cyclic;
+		};
+
+		/// <summary>
+		/// Neighbour and line tables of a topology other than the square grid, built when the table is sized.
+		/// Empty for the square grid.
+		/// </summary>
+		struct TopologyTables
+		{
+			/// <summary>
+			/// Next and previous cell of every cell along every axis, at cell * axisCount + axis. -1 past an edge.
+			/// </summary>
+			std::pmr::vector<S> next;
+			std::pmr::vector<S> previous;
+
+			/// <summary>
+			/// Cells of every line, one line after another, axis by axis.
+			/// </summary>
+			std::pmr::vector<S> lineCells;
+			std::pmr::vector<TopologyLine> lines;
+		};
+		TopologyTables topology;
+
+		/// <summary>
+		/// Events of the last operation. Reused, so recording doesn't allocate once it has grown.
+		/// </summary>
+		std::pmr::vector<BoardEvent> events;
+
+		/// <summary>
+		/// Called with the events at the end of every operation that records them.
+		/// </summary>
+		BoardEventObserver eventObserver;
+
+		/// <summary>
+		/// Keep events for GetEvents without an observer.
+		/// </summary>
+		bool recordEvents = false;
+
+		// Per thread, so tables can be used on many threads at once (e.g. by SessionHost)
+		inline static thread_local std::random_device randomDevice;
+		// 64 bit, so bulk draws get two numbers out of every step
+		inline static thread_local std::mt19937_64 randomGen = std::mt19937_64(randomDevice());
+
+	public:
+		Table()
+			: rowCount(0u), columnCount(0u), data(), possibleValues(), minimumMatchLength(3u)
+		{
+		}
+
+		Table(S rows, S columns, const std::vector<T>& possibleValues, int minMatchLength = 3u, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: rowCount(rows), columnCount(columns), data(rows* columns, resource), possibleValues(possibleValues.begin(), possibleValues.end(), resource), minimumMatchLength(minMatchLength), activeMask(resource), lineActiveMask(resource), diagonalRowOffsets(resource), specials(rows* columns, resource), payloads(hasPayload ? rows * columns : 0, resource), refillQueues(resource), refillHeads(resource), spawnWeights(resource), aliasThresholds(resource), aliasIndices(resource), events(resource)
+		{
+			ResetActiveMask();
+			BuildTopology();
+			PrepareRefillQueues(GetLaneLayout());
+		}
+
+		Table(MisketPosition size, const std::vector<T>& possibleValues, int minMatchLength = 3u, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: Table(size.row, size.column, possibleValues, minMatchLength, resource)
+		{
+		}
+
+		/// <summary>
+		/// Copy a table onto another memory resource.
+		/// </summary>
+		/// <remarks>
+		/// Every array of the copy, including the move tracker and the dirty lines, is allocated from the resource.
+		/// The copy uses the default scratch resource, since the original's is usually an arena of the thread working on it.
+		/// </remarks>
+		/// <param name="other">The table to copy.</param>
+		/// <param name="resource">Memory resource of the copy.</param>
+		Table(const Table& other, std::pmr::memory_resource* resource)
+			: rowCount(other.rowCount), columnCount(other.columnCount), data(other.data, resource), possibleValues(other.possibleValues, resource),
+			minimumMatchLength(other.minimumMatchLength), gravity(other.gravity), activeMask(other.activeMask, resource), lineActiveMask(other.lineActiveMask, resource),
+			diagonalRowOffsets(other.diagonalRowOffsets, resource), specials(other.specials, resource), payloads(other.payloads, resource),
+			refillQueues(other.refillQueues, resource), refillHeads(other.refillHeads, resource), refillQueueLength(other.refillQueueLength),
+			spawnWeights(other.spawnWeights, resource), aliasThresholds(other.aliasThresholds, resource), aliasIndices(other.aliasIndices, resource),
+			spawnWeightController(other.spawnWeightController),
+			moveTracker { other.moveTracker.enabled, other.moveTracker.minMatchLength, other.moveTracker.matchDirections, other.moveTracker.allDirty,
+				std::pmr::vector<S>(other.moveTracker.dirtyCells, resource), std::pmr::vector<S>(other.moveTracker.validSlots, resource),
+				std::pmr::vector<S>(other.moveTracker.slotPositions, resource) },
+			dirtyLines { std::pmr::vector<std::uint64_t>(other.dirtyLines.rows, resource), std::pmr::vector<std::uint64_t>(other.dirtyLines.columns, resource),
+				std::pmr::vector<std::uint64_t>(other.dirtyLines.downRight, resource), std::pmr::vector<std::uint64_t>(other.dirtyLines.downLeft, resource) },
+			topology { std::pmr::vector<S>(other.topology.next, resource), std::pmr::vector<S>(other.topology.previous, resource),
+				std::pmr::vector<S>(other.topology.lineCells, resource), std::pmr::vector<TopologyLine>(other.topology.lines, resource) },
+			events(other.events, resource), eventObserver(other.eventObserver), recordEvents(other.recordEvents)
+		{
+		}
+
+		/// <summary>
+		/// Copy a table onto the default memory resource, like the copy of a pmr container.
+		/// Use the copy with a resource to keep the copy in an arena.
+		/// </summary>
+		Table(const Table& other)
+			: Table(other, std::pmr::get_default_resource())
+		{
+		}
+
+		Table(Table&&) = default;
+		Table& operator=(const Table&) = default;
+		Table& operator=(Table&&) = default;
+
+		T& operator()(S row, S column)
+		{
+			MarkChanged(Index(row, column));
+			return data[Index(row, column)];
+		}
+
+		T& operator()(MisketPosition pos)
+		{
+			MarkChanged(Index(pos));
+			return data[Index(pos)];
+		}
+
+		const T& operator()(S row, S column) const
+		{
+			return data[Index(row, column)];
+		}
+
+		const T& operator()(MisketPosition pos) const
+		{
+			return data[Index(pos)];
+		}
+
+		T* operator[](S row)
+		{
+			MarkRowChanged(row);
+			return &data[row * columnCount];
+		}
+
+		const T* operator[](S row) const
+		{
+			return &data[row * columnCount];
+		}
+
+		/// <summary>
+		/// Get a misket from the table.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <returns>The misket at the specified row and column.</returns>
+		const T& Get(S row, S column) const
+		{
+			return data[Index(row, column)];
+		}
+
+		/// <summary>
+		/// Get a misket from the table.
+		/// </summary>
+		/// <param name="pos">The position of the misket.</param>
+		/// <returns>The misket at the specified position.</returns>
+		const T& Get(MisketPosition pos) const
+		{
+			return data[Index(pos)];
+		}
+
+		/// <summary>
+		/// Set a misket in the table.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <param name="value">The new misket value to set.</param>
+		void Set(S row, S column, const T& value)
+		{
+			data[Index(row, column)] = value;
+			MarkChanged(Index(row, column));
+		}
+
+		/// <summary>
+		/// Set a misket in the table.
+		/// </summary>
+		/// <param name="pos">The position of the misket.</param>
+		/// <param name="value">The new misket value to set.</param>
+		void Set(MisketPosition pos, const T& value)
+		{
+			data[Index(pos)] = value;
+			MarkChanged(Index(pos));
+		}
+
+		/// <summary>
+		/// Get the special type of a misket.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <returns>The special type of the misket at the specified row and column.</returns>
+		SpecialMisket GetSpecial(S row, S column) const
+		{
+			return specials[Index(row, column)];
+		}
+
+		/// <summary>
+		/// Get the special type of a misket.
+		/// </summary>
+		/// <param name="pos">The position of the misket.</param>
+		/// <returns>The special type of the misket at the specified position.</returns>
+		SpecialMisket GetSpecial(MisketPosition pos) const
+		{
+			return specials[Index(pos)];
+		}
+
+		/// <summary>
+		/// Set the special type of a misket.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <param name="special">The new special type.</param>
+		void SetSpecial(S row, S column, SpecialMisket special)
+		{
+			specials[Index(row, column)] = special;
+		}
+
+		/// <summary>
+		/// Set the special type of a misket.
+		/// </summary>
+		/// <param name="pos">The position of the misket.</param>
+		/// <param name="special">The new special type.</param>
+		void SetSpecial(MisketPosition pos, SpecialMisket special)
+		{
+			specials[Index(pos)] = special;
+		}
+
+		/// <summary>
+		/// Get the payload of a misket.
+		/// </summary>
+		/// <remarks>
+		/// Payloads follow their miskets through swaps and collapses.
+		/// Spawned miskets get a default payload, and so does every cell when the board is rebuilt or resized.
+		/// </remarks>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <returns>Reference to the payload at the specified row and column.</returns>
+		Payload& GetPayload(S row, S column) requires hasPayload
+		{
+			return payloads[Index(row, column)];
+		}
+
+		const Payload& GetPayload(S row, S column) const requires hasPayload
+		{
+			return payloads[Index(row, column)];
+		}
+
+		Payload& GetPayload(MisketPosition pos) requires hasPayload
+		{
+			return payloads[Index(pos)];
+		}
+
+		const Payload& GetPayload(MisketPosition pos) const requires hasPayload
+		{
+			return payloads[Index(pos)];
+		}
+
+		/// <summary>
+		/// Set the payload of a misket.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <param name="payload">The new payload.</param>
+		void SetPayload(S row, S column, Payload payload) requires hasPayload
+		{
+			payloads[Index(row, column)] = std::move(payload);
+		}
+
+		/// <summary>
+		/// Set the payload of a misket.
+		/// </summary>
+		/// <param name="pos">The position of the misket.</param>
+		/// <param name="payload">The new payload.</param>
+		void SetPayload(MisketPosition pos, Payload payload) requires hasPayload
+		{
+			payloads[Index(pos)] = std::move(payload);
+		}
+
+		/// <summary>
+		/// Get the number of rows in the table.
+		/// </summary>
+		/// <returns>The number of rows in the table.</returns>
+		S GetRowCount() const
+		{
+			return rowCount;
+		}
+
+		/// <summary>
+		/// Get the number of columns in the table.
+		/// </summary>
+		/// <returns>The number of columns in the table.</returns>
+		S GetColumnCount() const
+		{
+			return columnCount;
+		}
+
+		/// <summary>
+		/// Get the miskets new ones are drawn from.
+		/// </summary>
+		/// <returns>The possible values, in the order they were given.</returns>
+		std::span<const T> GetPossibleValues() const
+		{
+			return possibleValues;
+		}
+
+		/// <summary>
+		/// Get the minimum length of a match, used when no override is given.
+		/// </summary>
+		/// <returns>The minimum match length.</returns>
+		unsigned int GetMinimumMatchLength() const
+		{
+			return static_cast<unsigned int>(minimumMatchLength);
+		}
+
+		/// <summary>
+		/// Get the direction miskets fall to.
+		/// </summary>
+		/// <returns>The gravity direction of the table.</returns>
+		Gravity GetGravity() const
+		{
+			return gravity;
+		}
+
+		/// <summary>
+		/// Set the direction miskets fall to.
+		/// New miskets spawn from the opposite edge.
+		/// </summary>
+		/// <param name="newGravity">The new gravity direction.</param>
+		void SetGravity(Gravity newGravity)
+		{
+			gravity = newGravity;
+			PrepareRefillQueues(GetLaneLayout());
+		}
+
+		/// <summary>
+		/// Get the memory resource the board is stored in.
+		/// </summary>
+		/// <returns>The memory resource of the board storage.</returns>
+		std::pmr::memory_resource* GetMemoryResource() const
+		{
+			return data.get_allocator().resource();
+		}
+
+		/// <summary>
+		/// Get the memory resource used for temporaries and returned match groups.
+		/// </summary>
+		/// <returns>The scratch memory resource.</returns>
+		std::pmr::memory_resource* GetScratchResource() const
+		{
+			return scratchResource;
+		}
+
+		/// <summary>
+		/// Set the memory resource used for temporaries and returned match groups.
+		/// </summary>
+		/// <remarks>
+		/// Point this at a monotonic buffer to back a whole move's work with it, and reset the buffer after the move.
+		/// Match groups returned during the move must not be used after the reset.
+		/// </remarks>
+		/// <param name="resource">The new scratch resource. nullptr uses the default resource.</param>
+		void SetScratchResource(std::pmr::memory_resource* resource)
+		{
+			scratchResource = resource ? resource : std::pmr::get_default_resource();
+		}
+
+		/// <summary>
+		/// Set the observer of board events.
+		/// </summary>
+		/// <remarks>
+		/// SwapAndGetMatches, PopMiskets, PopMisketMatchGroups and ResolveMatchGroups record what they change
+		/// (swapped, matched, cleared, moved and spawned miskets) and pass the events to the observer when they finish.
+		/// Nothing is recorded while there is no observer and recording is off.
+		/// </remarks>
+		/// <param name="observer">The new observer. An empty function removes it.</param>
+		void SetEventObserver(BoardEventObserver observer)
+		{
+			eventObserver = std::move(observer);
+		}
+
+		/// <summary>
+		/// Keep the events of the last operation for GetEvents, with or without an observer.
+		/// </summary>
+		/// <param name="record">True to record events.</param>
+		void SetEventRecording(bool record)
+		{
+			recordEvents = record;
+		}
+
+		/// <summary>
+		/// Get the events of the last operation that recorded them.
+		/// </summary>
+		/// <returns>A span that is valid until the next operation.</returns>
+		std::span<const BoardEvent> GetEvents() const
+		{
+			return events;
+		}
+
+		/// <summary>
+		/// Get a row of the table.
+		/// </summary>
+		/// <param name="rowIndex">The index of the row to get.</param>
+		/// <returns>A row of the table.</returns>
+		std::vector<T> GetRow(S rowIndex) const
+		{
+			S start = rowIndex * columnCount;
+			return std::vector<T>(data.begin() + start, data.begin() + start + columnCount);
+		}
+
+		/// <summary>
+		/// Get a row of the table as a span.
+		/// </summary>
+		/// <param name="rowIndex">The index of the row to get.</param>
+		/// <returns>A row of the table as a span.</returns>
+		std::span<T> GetRowSpan(S rowIndex)
+		{
+			MarkRowChanged(rowIndex);
+			return { &data[rowIndex * columnCount], static_cast<size_t>(columnCount) };
+		}
+
+		/// <summary>
+		/// Get a row of the table as a span.
+		/// </summary>
+		/// <param name="rowIndex">The index of the row to get.</param>
+		/// <returns>A row of the table as a span.</returns>
+		std::span<const T> GetRowSpan(S rowIndex) const
+		{
+			return { &data[rowIndex * columnCount], static_cast<size_t>(columnCount) };
+		}
+
+		/// <summary>
+		/// Get a column of the table.
+		/// </summary>
+		/// <param name="columnIndex">The index of the column to get.</param>
+		/// <returns>A column of the table.</returns>
+		std::vector<T> GetColumn(S columnIndex) const
+		{
+			std::vector<T> column;
+			column.reserve(rowCount);
+			for (S i = 0; i < rowCount; ++i)
+			{
+				column.emplace_back(data[Index(i, columnIndex)]);
+			}
+			return column;
+		}
+
+		/// <summary>
+		/// Get a column of the table as a strided view, without copying it.
+		/// </summary>
+		/// <param name="columnIndex">The index of the column to get.</param>
+		/// <returns>A view of the column, from the top row.</returns>
+		StridedSpan<const T> GetColumnView(S columnIndex) const
+		{
+			return { data.data() + columnIndex, static_cast<size_t>(rowCount), columnCount };
+		}
+
+		/// <summary>
+		/// Get a Top-Left to Bottom-Right diagonal as a strided view, without copying it.
+		/// </summary>
+		/// <param name="row">Row of the first cell.</param>
+		/// <param name="column">Column of the first cell.</param>
+		/// <returns>A view from the cell to the bottom or right edge. Empty if the cell is out of bounds.</returns>
+		StridedSpan<const T> GetDiagonalView(S row, S column) const
+		{
+			if (!CheckBounds(row, column))
+				return {};
+
+			return { &data[Index(row, column)], static_cast<size_t>(std::min(rowCount - row, columnCount - column)), columnCount + 1 };
+		}
+
+		/// <summary>
+		/// Get a Top-Right to Bottom-Left diagonal as a strided view, without copying it.
+		/// </summary>
+		/// <param name="row">Row of the first cell.</param>
+		/// <param name="column">Column of the first cell.</param>
+		/// <returns>A view from the cell to the bottom or left edge. Empty if the cell is out of bounds.</returns>
+		StridedSpan<const T> GetAntiDiagonalView(S row, S column) const
+		{
+			if (!CheckBounds(row, column))
+				return {};
+
+			return { &data[Index(row, column)], static_cast<size_t>(std::min(rowCount - row, column + 1)), columnCount - 1 };
+		}
+
+		/// <summary>
+		/// Get the miskets of every cell, row-major, without copying them. Holes keep the value they had.
+		/// </summary>
+		std::span<const T> GetCells() const
+		{
+			return data;
+		}
+
+		/// <summary>
+		/// Get the special misket types of every cell, in the same order as GetCells.
+		/// </summary>
+		std::span<const SpecialMisket> GetSpecials() const
+		{
+			return specials;
+		}
+
+		/// <summary>
+		/// Get the activity of every cell, one bit per cell: cell i is bit i % 64 of word i / 64.
+		/// </summary>
+		std::span<const std::uint64_t> GetActiveMask() const
+		{
+			return activeMask;
+		}
+
+#ifdef __cpp_lib_mdspan
+		/// <summary>
+		/// Get the whole board as a 2D view, indexed by row and column, without copying it.
+		/// </summary>
+		std::mdspan<const T, std::dextents<S, 2>> GetBoardView() const
+		{
+			return std::mdspan<const T, std::dextents<S, 2>>(data.data(), rowCount, columnCount);
+		}
+#endif
+
+		/// <summary>
+		/// Set a row in the table.
+		/// </summary>
+		/// <param name="rowIndex">The index of the row to set.</param>
+		/// <param name="row">The misket values to set in the row. Any range of miskets, e.g. a span or a column view, even a view of this table.</param>
+		/// <returns>True if the row was set, false if the range is not as long as the row (the table is left unchanged).</returns>
+		template <std::ranges::input_range Range>
+			requires std::convertible_to<std::ranges::range_reference_t<Range>, T>
+		bool SetRow(S rowIndex, Range&& row)
+		{
+			// Copied out first, the range may read the cells being written
+			std::pmr::vector<T> values(scratchResource);
+			for (auto&& value : row)
+			{
+				values.push_back(static_cast<T>(value));
+			}
+
+			if (values.size() != static_cast<size_t>(columnCount))
+				return false;
+
+			std::ranges::copy(values, data.begin() + rowIndex * columnCount);
+			MarkRowChanged(rowIndex);
+			return true;
+		}
+
+		bool SetRow(S rowIndex, const std::vector<T>& row)
+		{
+			return SetRow(rowIndex, std::span<const T>(row));
+		}
+
+		/// <summary>
+		/// Set a column in the table.
+		/// </summary>
+		/// <param name="columnIndex">The index of the column to set.</param>
+		/// <param name="column">The misket values to set in the column. Any range of miskets, e.g. a span or a column view, even a view of this table.</param>
+		/// <returns>True if the column was set, false if the range is not as long as the column (the table is left unchanged).</returns>
+		template <std::ranges::input_range Range>
+			requires std::convertible_to<std::ranges::range_reference_t<Range>, T>
+		bool SetColumn(S columnIndex, Range&& column)
+		{
+			// Copied out first, the range may read the cells being written
+			std::pmr::vector<T> values(scratchResource);
+			for (auto&& value : column)
+			{
+				values.push_back(static_cast<T>(value));
+			}
+
+			if (values.size() != static_cast<size_t>(rowCount))
+				return false;
+
+			for (S i = 0; i < rowCount; ++i)
+			{
+				data[Index(i, columnIndex)] = values[i];
+				MarkChanged(Index(i, columnIndex));
+			}
+			return true;
+		}
+
+		bool SetColumn(S columnIndex, const std::vector<T>& column)
+		{
+			return SetColumn(columnIndex, std::span<const T>(column));
+		}
+
+		/// <summary>
+		/// Resize the table to the specified number of rows and columns.
+		/// </summary>
+		/// <param name="newRows">Target number of rows.</param>
+		/// <param name="newColumns">Target number of columns.</param>
+		void Resize(S newRows, S newColumns)
+		{
+			rowCount = newRows;
+			columnCount = newColumns;
+			data.resize(newRows * newColumns);
+			specials.assign(newRows * newColumns, SpecialMisket::None);
+			payloads.assign(hasPayload ? newRows * newColumns : 0, Payload());
+			ResetActiveMask();
+			BuildTopology();
+			PrepareRefillQueues(GetLaneLayout());
+		}
+
+		/// <summary>
+		/// Clear the table and reset its size to 0.
+		/// </summary>
+		void Clear()
+		{
+			data.clear();
+			activeMask.clear();
+			lineActiveMask.clear();
+			diagonalRowOffsets.clear();
+			specials.clear();
+			payloads.clear();
+			rowCount = 0u;
+			columnCount = 0u;
+			BuildTopology();
+			PrepareRefillQueues(GetLaneLayout());
+			MarkAllChanged();
+		}
+
+		/// <summary>
+		/// Find the cells that differ from another board: their miskets, special miskets or activity.
+		/// </summary>
+		/// <remarks>
+		/// <para>
+		/// The boards are compared 64 cells at a time, one word of the changed mask per block.
+		/// Miskets with unique object representations (integers, enums...) are compared with memcmp first,
+		/// so unchanged blocks cost a couple of block compares and the work follows the changes.
+		/// </para>
+		/// <para>
+		/// Only cell contents are compared. Payloads, gravity, spawn weights and refill queues are not part of a patch.
+		/// If the sizes differ, every cell is in the patch.
+		/// </para>
+		/// </remarks>
+		/// <param name="previous">The board to diff against, e.g. the last state sent to a client.</param>
+		/// <returns>A patch that turns previous into this board.</returns>
+		BoardPatch Diff(const Table& previous) const
+		{
+			const S cellCount = static_cast<S>(data.size());
+			const bool sameSize = previous.rowCount == rowCount && previous.columnCount == columnCount;
+
+			BoardPatch patch { .rowCount = rowCount, .columnCount = columnCount, .changedMask = std::pmr::vector<std::uint64_t>(activeMask.size(), 0, scratchResource),
+				.indices = std::pmr::vector<S>(scratchResource), .values = std::pmr::vector<T>(scratchResource),
+				.specials = std::pmr::vector<SpecialMisket>(scratchResource), .active = std::pmr::vector<bool>(scratchResource) };
+
+			for (size_t word = 0; word < activeMask.size(); ++word)
+			{
+				const S begin = static_cast<S>(word * 64);
+				const S end = std::min<S>(begin + 64, cellCount);
+
+				std::uint64_t changed = ~std::uint64_t(0) >> (64 - (end - begin));
+				if (sameSize)
+				{
+					changed = activeMask[word] ^ previous.activeMask[word];
+
+					// Equal bytes are equal miskets, so a matching block is skipped without comparing cell by cell
+					bool sameBytes = false;
+					if constexpr (std::has_unique_object_representations_v<T>)
+					{
+						sameBytes = std::memcmp(data.data() + begin, previous.data.data() + begin, (end - begin) * sizeof(T)) == 0;
+					}
+
+					if (!sameBytes || std::memcmp(specials.data() + begin, previous.specials.data() + begin, (end - begin) * sizeof(SpecialMisket)) != 0)
+					{
+						for (S i = begin; i < end; ++i)
+						{
+							changed |= std::uint64_t(!(data[i] == previous.data[i]) | (specials[i] != previous.specials[i])) << (i - begin);
+						}
+					}
+				}
+
+				patch.changedMask[word] = changed;
+				for (; changed != 0; changed &= changed - 1)
+				{
+					const S index = begin + std::countr_zero(changed);
+					patch.indices.push_back(index);
+					patch.values.push_back(data[index]);
+					patch.specials.push_back(specials[index]);
+					patch.active.push_back(IsActiveIndex(index));
+				}
+			}
+
+			return patch;
+		}
+
+		/// <summary>
+		/// Write the changed cells of a patch from Diff.
+		/// The table is resized first if the patch is for another size.
+		/// </summary>
+		/// <param name="patch">Patch from Diff, made against a board with the same contents as this one.</param>
+		void ApplyPatch(const BoardPatch& patch)
+		{
+			if (patch.rowCount != rowCount || patch.columnCount != columnCount)
+			{
+				Resize(patch.rowCount, patch.columnCount);
+			}
+
+			for (size_t k = 0; k < patch.indices.size(); ++k)
+			{
+				const S index = patch.indices[k];
+
+				data[index] = patch.values[k];
+				specials[index] = patch.specials[k];
+				WriteActiveBit(index, patch.active[k]);
+
+				MarkChanged(index);
+			}
+		}
+
+		/// <summary>
+		/// Check if the specified row and column are within the bounds of the table.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <returns>True if the row and column are within bounds, false otherwise.</returns>
+		bool CheckBounds(S row, S column) const
+		{
+			return row >= 0 && column >= 0 && row < rowCount && column < columnCount;
+		}
+
+		/// <summary>
+		/// Check if the specified position is within the bounds of the table.
+		/// </summary>
+		/// <param name="pos">The position to check.</param>
+		/// <returns>True if the position is within bounds, false otherwise.</returns>
 		bool CheckBounds(MisketPosition pos) const
 		{
-			return CheckBounds(pos.row, pos.column);
+			return CheckBounds(pos.row, pos.column);
+		}
+
+		/// <summary>
+		/// Check if the specified packed position is within the bounds of the table.
+		/// </summary>
+		/// <param name="pos">The packed position to check.</param>
+		/// <returns>True if the position is within bounds, false otherwise.</returns>
+		template <std::unsigned_integral I>
+		bool CheckBounds(PackedPosition<I> pos) const
+		{
+			return pos.index < data.size();
+		}
+
+		/// <summary>
+		/// Can every cell of the table be packed into the index type I?
+		/// </summary>
+		/// <typeparam name="I">Unsigned index type of the packed positions.</typeparam>
+		/// <returns>True if the cell count fits into I.</returns>
+		template <std::unsigned_integral I = std::uint32_t>
+		bool CanPack() const
+		{
+			return data.size() <= static_cast<size_t>(std::numeric_limits<I>::max()) + 1;
+		}
+
+		/// <summary>
+		/// Pack a position into a linear cell index.
+		/// </summary>
+		/// <typeparam name="I">Unsigned index type of the packed position. See CanPack.</typeparam>
+		/// <param name="pos">The position to pack.</param>
+		/// <returns>The packed position.</returns>
+		template <std::unsigned_integral I = std::uint32_t>
+		PackedPosition<I> Pack(MisketPosition pos) const
+		{
+			return PackedPosition<I>(pos.row, pos.column, columnCount);
+		}
+
+		/// <summary>
+		/// Unpack a linear cell index into row and column.
+		/// </summary>
+		/// <param name="pos">The packed position.</param>
+		/// <returns>The position as row and column.</returns>
+		template <std::unsigned_integral I>
+		MisketPosition Unpack(PackedPosition<I> pos) const
+		{
+			return pos.ToVector2D(columnCount);
+		}
+
+		/// <summary>
+		/// Is the cell part of the board?
+		/// Inactive cells are holes, used for boards that aren't rectangles.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <returns>True if the cell is within bounds and active, false otherwise.</returns>
+		bool IsActive(S row, S column) const
+		{
+			return CheckBounds(row, column) && IsActiveIndex(Index(row, column));
+		}
+
+		/// <summary>
+		/// Is the cell part of the board?
+		/// Inactive cells are holes, used for boards that aren't rectangles.
+		/// </summary>
+		/// <param name="pos">The position of the cell.</param>
+		/// <returns>True if the cell is within bounds and active, false otherwise.</returns>
+		bool IsActive(MisketPosition pos) const
+		{
+			return IsActive(pos.row, pos.column);
+		}
+
+		/// <summary>
+		/// Add a cell to the board or make it a hole.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <param name="active">True to make the cell part of the board, false to make it a hole.</param>
+		void SetActive(S row, S column, bool active)
+		{
+			const S index = Index(row, column);
+			WriteActiveBit(index, active);
+			MarkChanged(index);
+		}
+
+		/// <summary>
+		/// Add a cell to the board or make it a hole.
+		/// </summary>
+		/// <param name="pos">The position of the cell.</param>
+		/// <param name="active">True to make the cell part of the board, false to make it a hole.</param>
+		void SetActive(MisketPosition pos, bool active)
+		{
+			SetActive(pos.row, pos.column, active);
+		}
+
+		/// <summary>
+		/// Make every cell of the table active.
+		/// </summary>
+		void ResetActiveMask()
+		{
+			const size_t cellCount = data.size();
+			activeMask.assign((cellCount + 63) / 64, ~std::uint64_t(0));
+
+			// Bits past the last cell stay clear
+			if (cellCount % 64)
+				activeMask.back() = (std::uint64_t(1) << (cellCount % 64)) - 1;
+
+			LayOutLineActiveMask();
+			MarkAllChanged();
+		}
+
+		/// <summary>
+		/// Get the number of active cells.
+		/// </summary>
+		/// <returns>The number of cells that are part of the board.</returns>
+		S GetActiveCount() const
+		{
+			S count = 0;
+			for (const auto word : activeMask)
+			{
+				count += std::popcount(word);
+			}
+			return count;
+		}
+
+		/// <summary>
+		/// Randomise the table using a range of possible values.
+		/// Special miskets and payloads are removed.
+		/// </summary>
+		/// <param name="checkMatches">Should we check for matches and re-randomise matching elements?</param>
+		void Randomise(bool checkMatches = true)
+		{
+			const S cellCount = static_cast<S>(data.size());
+			std::fill(specials.begin(), specials.end(), SpecialMisket::None);
+			std::fill(payloads.begin(), payloads.end(), Payload());
+			MarkAllChanged();
+
+			for (S begin = NextActiveIndex(0, cellCount); begin < cellCount;)
+			{
+				const S end = NextInactiveIndex(begin, cellCount);
+				for (S index = begin; index < end; ++index)
+				{
+					data[index] = GenerateRandomMisket();
+				}
+				begin = NextActiveIndex(end, cellCount);
+			}
+
+			if (!checkMatches)
+			{
+				return;
+			}
+
+			// Check for matches and re-randomise matching elements
+			auto matchGroups = FindMatchGroups();
+
+			while (!matchGroups.empty())
+			{
+				for (const auto& group : matchGroups)
+				{
+					for (const auto& pos : group)
+					{
+						Set(pos, GenerateRandomMisket());
+					}
+				}
+				matchGroups = FindMatchGroups();
+			}
+		}
+		
+		/*
+		// Debug
+		// Get random misket from table
+		T& GetRandomisedMisket()
+		{
+			std::uniform_int_distribution<S> dis(0, data.size() - 1);
+			return data[dis(randomGen)];
+		}
+		*/
+
+		/// <summary>
+		/// Seed the random generator of the calling thread, for repeatable boards and spawns.
+		/// Every thread has its own generator, shared by all tables used on it.
+		/// </summary>
+		/// <param name="seed">The seed.</param>
+		static void SeedRandom(std::uint64_t seed)
+		{
+			randomGen.seed(seed);
+		}
+
+		/// <summary>
+		/// Generate a random misket from the possible values.
+		/// </summary>
+		/// <returns>A generated random misket.</returns>
+		T GenerateRandomMisket()
+		{
+			if (!aliasIndices.empty())
+			{
+				return possibleValues[DrawWeightedIndex(randomGen())];
+			}
+
+			std::uniform_int_distribution<S> dis(0, possibleValues.size() - 1);
+			return possibleValues[dis(randomGen)];
+		}
+
+		/// <summary>
+		/// Fill a buffer with random miskets from the possible values, in bulk.
+		/// </summary>
+		/// <remarks>
+		/// With spawn weights, every misket is one alias table draw from one step of the generator.
+		/// Without them, raw numbers are drawn in batches, two from every step of the generator,
+		/// and reduced to indices with a multiply and a shift (Lemire's method),
+		/// in a loop the compiler can vectorise. The rare biased draws are detected in the same pass and redrawn.
+		/// </remarks>
+		/// <param name="miskets">The buffer to fill.</param>
+		void GenerateRandomMiskets(std::span<T> miskets)
+		{
+			const std::uint32_t valueCount = static_cast<std::uint32_t>(possibleValues.size());
+			if (valueCount == 0)
+				return;
+
+			if (!aliasIndices.empty())
+			{
+				for (T& misket : miskets)
+				{
+					misket = possibleValues[DrawWeightedIndex(randomGen())];
+				}
+				return;
+			}
+
+			// Draws whose low half is below 2^32 mod valueCount would make some values more likely
+			const std::uint32_t threshold = static_cast<std::uint32_t>(-valueCount) % valueCount;
+
+			constexpr size_t batchSize = 64;
+			std::array<std::uint32_t, batchSize> raw;
+			std::array<std::uint32_t, batchSize> indices;
+
+			for (size_t begin = 0; begin < miskets.size(); begin += batchSize)
+			{
+				const size_t count = std::min(batchSize, miskets.size() - begin);
+				for (size_t i = 0; i < count; i += 2)
+				{
+					const std::uint64_t bits = randomGen();
+					raw[i] = static_cast<std::uint32_t>(bits);
+					raw[i + 1] = static_cast<std::uint32_t>(bits >> 32);
+				}
+
+				bool biased = false;
+				for (size_t i = 0; i < count; ++i)
+				{
+					const std::uint64_t product = std::uint64_t(raw[i]) * valueCount;
+					indices[i] = static_cast<std::uint32_t>(product >> 32);
+					biased |= static_cast<std::uint32_t>(product) < threshold;
+				}
+
+				if (biased)
+				{
+					for (size_t i = 0; i < count; ++i)
+					{
+						std::uint64_t product = std::uint64_t(raw[i]) * valueCount;
+						while (static_cast<std::uint32_t>(product) < threshold)
+						{
+							product = std::uint64_t(static_cast<std::uint32_t>(randomGen())) * valueCount;
+						}
+						indices[i] = static_cast<std::uint32_t>(product >> 32);
+					}
+				}
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					miskets[begin + i] = possibleValues[indices[i]];
+				}
+			}
+		}
+
+		/// <summary>
+		/// See the next miskets that will spawn into a lane.
+		/// </summary>
+		/// <remarks>
+		/// Spawns come from per-lane queues that are filled in bulk. The first misket of the preview
+		/// is the next one to spawn, and it lands the furthest from the spawn edge.
+		/// Lanes are columns for vertical gravity and rows for horizontal gravity.
+		/// </remarks>
+		/// <param name="lane">The column or row.</param>
+		/// <param name="count">Number of miskets to preview. At most the length of the lane, or 8 for shorter lanes.</param>
+		/// <returns>The next miskets, valid until the table is changed.</returns>
+		std::span<const T> PreviewRefills(S lane, S count)
+		{
+			const LaneLayout lanes = GetLaneLayout();
+			if (lane < 0 || lane >= lanes.laneCount)
+				return {};
+
+			count = std::clamp<S>(count, 0, refillQueueLength);
+
+			T* queue = &refillQueues[static_cast<size_t>(lane) * refillQueueLength];
+			S& head = refillHeads[lane];
+
+			// Not enough left, keep the rest at the front and fill up behind it
+			if (refillQueueLength - head < count)
+			{
+				const S left = refillQueueLength - head;
+				std::move(queue + head, queue + refillQueueLength, queue);
+				GenerateRandomMiskets({ queue + left, static_cast<size_t>(refillQueueLength - left) });
+				head = 0;
+			}
+
+			return { queue + head, static_cast<size_t>(count) };
+		}
+
+		/// <summary>
+		/// Drop the pre-generated spawns, e.g. so new spawn weights apply at once.
+		/// </summary>
+		void ClearRefillQueues()
+		{
+			std::fill(refillHeads.begin(), refillHeads.end(), refillQueueLength);
+		}
+
+		/// <summary>
+		/// Set how likely every possible value is to spawn.
+		/// </summary>
+		/// <remarks>
+		/// The weights are turned into a Walker's alias table in O(n), after which every draw is O(1).
+		/// Spawns already in the refill queues keep their values, so previews stay true.
+		/// Call ClearRefillQueues to apply the weights to them too.
+		/// </remarks>
+		/// <param name="weights">One weight per possible value, in the same order. Empty for uniform spawns.</param>
+		/// <returns>False if the weights don't match the possible values, are negative or are all zero. Nothing is changed then.</returns>
+		bool SetSpawnWeights(std::span<const double> weights)
+		{
+			if (weights.empty())
+			{
+				spawnWeights.clear();
+				aliasThresholds.clear();
+				aliasIndices.clear();
+				return true;
+			}
+
+			if (weights.size() != possibleValues.size())
+				return false;
+
+			double total = 0.0;
+			for (const double weight : weights)
+			{
+				if (!(weight >= 0.0) || !std::isfinite(weight))
+					return false;
+				total += weight;
+			}
+
+			if (!(total > 0.0))
+				return false;
+
+			spawnWeights.assign(weights.begin(), weights.end());
+			BuildAliasTable(total);
+			return true;
+		}
+
+		/// <summary>
+		/// Set the spawn weight of a single possible value.
+		/// Uniform spawns get a weight of 1 for every other value.
+		/// </summary>
+		/// <param name="valueIndex">Index of the value in the possible values.</param>
+		/// <param name="weight">The new weight.</param>
+		/// <returns>False if the index is out of range, or the weights would be invalid. See SetSpawnWeights.</returns>
+		bool SetSpawnWeight(size_t valueIndex, double weight)
+		{
+			if (valueIndex >= possibleValues.size())
+				return false;
+
+			std::pmr::vector<double> weights(scratchResource);
+			if (spawnWeights.empty())
+				weights.assign(possibleValues.size(), 1.0);
+			else
+				weights.assign(spawnWeights.begin(), spawnWeights.end());
+
+			weights[valueIndex] = weight;
+			return SetSpawnWeights(weights);
+		}
+
+		/// <summary>
+		/// Get the spawn weights.
+		/// </summary>
+		/// <returns>One weight per possible value, empty for uniform spawns.</returns>
+		std::span<const double> GetSpawnWeights() const
+		{
+			return spawnWeights;
+		}
+
+		/// <summary>
+		/// Set a controller that adjusts the spawn weights after every cascade step.
+		/// </summary>
+		/// <remarks>
+		/// The controller runs at the end of ResolveMatchGroups, after the collapse, and the alias table
+		/// is only rebuilt when it reports a change. Refills never wait for it.
+		/// With uniform spawns, it gets a weight of 1 for every value.
+		/// </remarks>
+		/// <param name="controller">The new controller. An empty function removes it.</param>
+		void SetSpawnWeightController(SpawnWeightController controller)
+		{
+			spawnWeightController = std::move(controller);
+		}
+
+		/// <summary>
+		/// Shuffles the active cells of the table.
+		/// Special miskets and payloads are removed.
+		/// </summary>
+		void Shuffle()
+		{
+			std::pmr::vector<T> values = GetActiveValues();
+			std::shuffle(values.begin(), values.end(), randomGen);
+			SetActiveValues(values);
+			std::fill(specials.begin(), specials.end(), SpecialMisket::None);
+			std::fill(payloads.begin(), payloads.end(), Payload());
+		}
+
+		/// <summary>
+		/// Rearranges the miskets into a board that has no matches and at least one valid move.
+		/// </summary>
+		/// <remarks>
+		/// The board is built constructively, not by shuffling until it works:
+		/// a valid move is planted first, then every other cell is filled
+		/// with a misket that does not complete a match.
+		/// 
+		/// The current miskets are reused when they can form such a board.
+		/// Otherwise (e.g. too few of any colour are left) the board is built from the possible values.
+		/// Special miskets and payloads are removed.
+		/// </remarks>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>True if the board was rebuilt, false if no solvable board fits the table (it is left unchanged).</returns>
+		bool Reshuffle(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections())
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			if (GetActiveCount() == 0)
+			{
+				return false;
+			}
+
+			std::pmr::vector<T> pool = GetActiveValues();
+			std::shuffle(pool.begin(), pool.end(), randomGen);
+
+			if (BuildSolvableBoard(std::move(pool), false, minMatchLength, matchDirections))
+			{
+				return true;
+			}
+
+			return !possibleValues.empty() && BuildSolvableBoard(std::pmr::vector<T>(possibleValues, scratchResource), true, minMatchLength, matchDirections);
+		}
+
+		/// <summary>
+		/// Swap two miskets in the table.
+		/// </summary>
+		/// <param name="row1">Row of the first misket.</param>
+		/// <param name="col1">Column of the first misket.</param>
+		/// <param name="row2">Row of the second misket.</param>
+		/// <param name="col2">Column of the second misket.</param>
+		void Swap(S row1, S col1, S row2, S col2)
+		{
+			std::swap((*this)(row1, col1), (*this)(row2, col2));
+			std::swap(specials[Index(row1, col1)], specials[Index(row2, col2)]);
+			if constexpr (hasPayload)
+			{
+				std::swap(payloads[Index(row1, col1)], payloads[Index(row2, col2)]);
+			}
+		}
+
+		/// <summary>
+		/// Swap two miskets in the table.
+		/// </summary>
+		/// <param name="pos1">Position of the first misket.</param>
+		/// <param name="pos2">Position of the second misket.</param>
+		void Swap(MisketPosition pos1, MisketPosition pos2)
+		{
+			Swap(pos1.row, pos1.column, pos2.row, pos2.column);
+		}
+
+		/// <summary>
+		/// Check if two positions are adjacent.
+		/// On topologies other than the square grid, neighbours are looked up in the topology's tables.
+		/// </summary>
+		/// <param name="row1">Row of the first position.</param>
+		/// <param name="col1">Column of the first position.</param>
+		/// <param name="row2">Row of the second position.</param>
+		/// <param name="col2">Column of the second position.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>True if the positions are adjacent, false otherwise.</returns>
+		bool IsAdjacent(S row1, S col1, S row2, S col2, MatchDirections matchDirections = MatchDirections()) const
+		{
+			if constexpr (!Topology::isSquare)
+			{
+				if (!CheckBounds(row1, col1) || !CheckBounds(row2, col2))
+					return false;
+
+				const S index1 = Index(row1, col1);
+				const S index2 = Index(row2, col2);
+				for (int axis = 0; axis < axisCount; ++axis)
+				{
+					if (IsAxisEnabled(axis, matchDirections) && index1 != index2 &&
+						(topology.next[index1 * axisCount + axis] == index2 || topology.previous[index1 * axisCount + axis] == index2))
+						return true;
+				}
+				return false;
+			}
+
+			if (matchDirections.horizontal && row1 == row2 && std::abs(col1 - col2) == 1)
+				return true;
+
+			if (matchDirections.vertical && col1 == col2 && std::abs(row1 - row2) == 1)
+				return true;
+
+			if (matchDirections.diagonal && std::abs(row1 - row2) == 1 && std::abs(col1 - col2) == 1)
+				return true;
+
+			return false;
+		}
+
+		bool IsAdjacent(MisketPosition pos1, MisketPosition pos2, MatchDirections matchDirections = MatchDirections()) const
+		{
+			return IsAdjacent(pos1.row, pos1.column, pos2.row, pos2.column, matchDirections);
+		}
+
+		/// <summary>
+		/// Find matches in the table and return as groups of matches.
+		/// </summary>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>A vector of match groups.</returns>
+		MisketMatchGroups FindMatchGroups(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			return CollectMatchGroups<MisketPosition>(minMatchLength, matchDirections, [](S row, S column)
+				{
+					return MisketPosition(row, column);
+				});
+		}
+
+		/// <summary>
+		/// Find matches in the table and return as groups of packed positions.
+		/// Same groups as FindMatchGroups, in a fraction of the memory.
+		/// </summary>
+		/// <typeparam name="I">Unsigned index type of the positions. See CanPack.</typeparam>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>A vector of packed match groups.</returns>
+		template <std::unsigned_integral I = std::uint32_t>
+		PackedMisketMatchGroups<I> FindPackedMatchGroups(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			return CollectMatchGroups<PackedPosition<I>>(minMatchLength, matchDirections, [this](S row, S column)
+				{
+					return PackedPosition<I>(row, column, columnCount);
+				});
+		}
+
+		/// <summary>
+		/// Find matches on the lines changed since the last call, and mark every line clean.
+		/// </summary>
+		/// <remarks>
+		/// <para>
+		/// Every write to a cell marks its row, its column and its diagonals dirty.
+		/// Only the dirty lines are scanned, in place, so after a swap the work is a few lines instead of the whole board.
+		/// </para>
+		/// <para>
+		/// Matches only appear on changed lines, so the groups are the same as FindMatchGroups, in the same order,
+		/// as long as every group of the last scan was cleared and the rules are the same.
+		/// After a full scan, call ClearDirtyLines before popping its groups, e.g. between SwapAndGetMatches and the cascade.
+		/// </para>
+		/// </remarks>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>A vector of match groups.</returns>
+		MisketMatchGroups FindDirtyMatchGroups(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections())
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			// Dirty lines are the square grid's, other topologies are scanned whole
+			if constexpr (!Topology::isSquare)
+			{
+				ClearDirtyLines();
+				return FindMatchGroups(minMatchLength, matchDirections);
+			}
+
+			MisketMatchGroups matchGroups(scratchResource);
+
+			auto addGroup = [&](const LineDescriptor& line, S first, S length)
+			{
+				MisketMatchGroup& group = matchGroups.emplace_back();
+				group.reserve(length);
+				for (S k = first; k < first + length; ++k)
+				{
+					group.push_back(MisketPosition(line.row + k * line.dRow, line.column + k * line.dCol));
+				}
+			};
+
+			const std::pmr::vector<LineDescriptor> lines = GetInPlaceLineDescriptors(minMatchLength, matchDirections, true);
+			ScanLines(data.data(), Key(), lineActiveMask.data(), lines, minMatchLength, addGroup);
+
+			ClearDirtyLines();
+			return matchGroups;
+		}
+
+		/// <summary>
+		/// Mark every line clean, e.g. after a full scan whose groups are all going to be cleared.
+		/// </summary>
+		void ClearDirtyLines()
+		{
+			for (auto* lines : { &dirtyLines.rows, &dirtyLines.columns, &dirtyLines.downRight, &dirtyLines.downLeft })
+			{
+				std::fill(lines->begin(), lines->end(), 0);
+			}
+		}
+
+	private:
+		/// <summary>
+		/// Match scan behind FindMatchGroups and FindPackedMatchGroups.
+		/// </summary>
+		/// <remarks>
+		/// Every direction is a set of line descriptors run through the same kernel, ScanLines.
+		/// Every line is scanned in place, diagonals with a stride of a row plus or minus a cell,
+		/// so a scan allocates nothing but its groups and line descriptors.
+		/// Other topologies are scanned in a copy gathered from their line tables.
+		/// </remarks>
+		/// <typeparam name="Position">Position type stored in the groups.</typeparam>
+		/// <param name="makePosition">Makes a Position from a row and a column.</param>
+		template <typename Position, typename MakePosition>
+		std::pmr::vector<std::pmr::vector<Position>> CollectMatchGroups(unsigned int minMatchLength, MatchDirections matchDirections, MakePosition&& makePosition) const
+		{
+			using Group = std::pmr::vector<Position>;
+
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			std::pmr::vector<Group> matchGroups(scratchResource);
+
+			if constexpr (!Topology::isSquare)
+			{
+				const GatheredLines gathered = GatherLines(minMatchLength, matchDirections);
+				ScanLines(gathered.values.data(), std::identity(), gathered.active.data(), gathered.lines, minMatchLength,
+					[&](const LineDescriptor& line, S first, S length)
+					{
+						Group& group = matchGroups.emplace_back();
+						group.reserve(length);
+						for (S k = line.start + first; k < line.start + first + length; ++k)
+						{
+							group.push_back(makePosition(gathered.cells[k] / columnCount, gathered.cells[k] % columnCount));
+						}
+					});
+
+				return matchGroups;
+			}
+
+			auto addGroup = [&](const LineDescriptor& line, S first, S length)
+			{
+				Group& group = matchGroups.emplace_back();
+				group.reserve(length);
+				for (S k = first; k < first + length; ++k)
+				{
+					group.push_back(makePosition(line.row + k * line.dRow, line.column + k * line.dCol));
+				}
+			};
+
+			const std::pmr::vector<LineDescriptor> lines = GetInPlaceLineDescriptors(minMatchLength, matchDirections, false);
+			ScanLines(data.data(), Key(), lineActiveMask.data(), lines, minMatchLength, addGroup);
+
+			return matchGroups;
+		}
+
+		/// <summary>
+		/// A line of cells to scan for runs.
+		/// Cell k is at start + k * stride in the scanned buffer, and at (row + k * dRow, column + k * dCol) on the board.
+		/// Its activity is bit activeStart + k of the scan's activity mask, whatever the stride.
+		/// </summary>
+		struct LineDescriptor
+		{
+			S start;
+			S stride;
+			S length;
+			S row;
+			S column;
+			S dRow;
+			S dCol;
+			S activeStart;
+		};
+
+		/// <summary>
+		/// Match keys along the lines of a topology, gathered into one buffer, one contiguous line after another.
+		/// </summary>
+		struct GatheredLines
+		{
+			std::pmr::vector<KeyType> values;
+
+			/// <summary>
+			/// One bit per gathered cell.
+			/// </summary>
+			std::pmr::vector<std::uint64_t> active;
+
+			/// <summary>
+			/// Data index of every gathered cell.
+			/// </summary>
+			std::pmr::vector<S> cells;
+			std::pmr::vector<LineDescriptor> lines;
+		};
+
+		/// <summary>
+		/// Gather the lines of the topology that can hold a match, from its line table.
+		/// A cycle is gathered from the start of a run, so no run is split at the end of the buffer.
+		/// </summary>
+		/// <param name="minMatchLength">Shorter lines are left out.</param>
+		GatheredLines GatherLines(unsigned int minMatchLength, MatchDirections matchDirections) const
+		{
+			GatheredLines gathered { std::pmr::vector<KeyType>(scratchResource), std::pmr::vector<std::uint64_t>(scratchResource),
+				std::pmr::vector<S>(scratchResource), std::pmr::vector<LineDescriptor>(scratchResource) };
+			gathered.values.reserve(topology.lineCells.size());
+			gathered.active.reserve((topology.lineCells.size() + 63) / 64);
+			gathered.cells.reserve(topology.lineCells.size());
+
+			for (const TopologyLine& line : topology.lines)
+			{
+				if (!IsAxisEnabled(line.axis, matchDirections) || line.length < static_cast<S>(minMatchLength))
+					continue;
+
+				const S* cells = &topology.lineCells[line.start];
+
+				// First cell that doesn't continue the run of the cell before it. None if the whole cycle is one run.
+				S first = 0;
+				if (line.cyclic)
+				{
+					for (; first < line.length; ++first)
+					{
+						const S cell = cells[first];
+						const S before = cells[first > 0 ? first - 1 : line.length - 1];
+						if (!IsActiveIndex(cell) || !IsActiveIndex(before) || !SameKey(data[cell], data[before]))
+							break;
+					}
+
+					if (first == line.length)
+						first = 0;
+				}
+
+				const S lineStart = static_cast<S>(gathered.values.size());
+				gathered.lines.push_back({ lineStart, 1, line.length, 0, 0, 0, 0, lineStart });
+				gathered.active.resize((lineStart + line.length + 63) / 64, 0);
+				for (S k = 0; k < line.length; ++k)
+				{
+					const S cell = cells[first + k < line.length ? first + k : first + k - line.length];
+					gathered.values.push_back(KeyOf(data[cell]));
+					gathered.active[(lineStart + k) >> 6] |= std::uint64_t(IsActiveIndex(cell)) << ((lineStart + k) & 63);
+					gathered.cells.push_back(cell);
+				}
+			}
+
+			return gathered;
+		}
+
+		/// <summary>
+		/// Line descriptors of every direction, in data, in the order of a full scan.
+		/// Diagonals are scanned in place, with a stride of a row plus or minus a cell.
+		/// </summary>
+		/// <param name="minMatchLength">Shorter diagonals are left out.</param>
+		/// <param name="dirtyOnly">Leave out the lines that haven't changed since the last dirty scan.</param>
+		std::pmr::vector<LineDescriptor> GetInPlaceLineDescriptors(unsigned int minMatchLength, MatchDirections matchDirections, bool dirtyOnly) const
+		{
+			std::pmr::vector<LineDescriptor> lines(scratchResource);
+			if (rowCount == 0 || columnCount == 0)
+				return lines;
+
+			if (matchDirections.horizontal)
+			{
+				for (S row = 0; row < rowCount; ++row)
+				{
+					if (!dirtyOnly || DirtyLines::Test(dirtyLines.rows, row))
+						lines.push_back({ Index(row, 0), 1, columnCount, row, 0, 0, 1, ActiveBitAlong(row, 0, 0, 1) });
+				}
+			}
+
+			if (matchDirections.vertical)
+			{
+				for (S col = 0; col < columnCount; ++col)
+				{
+					if (!dirtyOnly || DirtyLines::Test(dirtyLines.columns, col))
+						lines.push_back({ col, columnCount, rowCount, 0, col, 1, 0, ActiveBitAlong(0, col, 1, 0) });
+				}
+			}
+
+			if (!matchDirections.diagonal)
+				return lines;
+
+			auto addDiagonal = [&](const std::pmr::vector<std::uint64_t>& dirty, S id, S row, S column, S dCol, S length)
+			{
+				if (length >= static_cast<S>(minMatchLength) && (!dirtyOnly || DirtyLines::Test(dirty, id)))
+					lines.push_back({ Index(row, column), columnCount + dCol, length, row, column, 1, dCol, ActiveBitAlong(row, column, 1, dCol) });
+			};
+
+			// Top-Left to Bottom-Right, numbered by column - row + rowCount - 1
+			for (S row = 0; row < rowCount; ++row)
+			{
+				addDiagonal(dirtyLines.downRight, rowCount - 1 - row, row, 0, 1, std::min(rowCount - row, columnCount));
+			}
+			for (S col = 1; col < columnCount; ++col)
+			{
+				addDiagonal(dirtyLines.downRight, rowCount - 1 + col, 0, col, 1, std::min(rowCount, columnCount - col));
+			}
+
+			// Top-Right to Bottom-Left, numbered by row + column
+			for (S row = 0; row < rowCount; ++row)
+			{
+				addDiagonal(dirtyLines.downLeft, row + columnCount - 1, row, columnCount - 1, -1, std::min(rowCount - row, columnCount));
+			}
+			for (S col = columnCount - 2; col >= 0; --col)
+			{
+				addDiagonal(dirtyLines.downLeft, col, 0, col, -1, std::min(rowCount, col + 1));
+			}
+
+			return lines;
+		}
+
+		/// <summary>
+		/// Run detection kernel. Finds every run of at least minMatchLength equal, active values on the lines.
+		/// Inactive cells end the current run.
+		/// </summary>
+		/// <remarks>
+		/// Inactive spans are skipped a mask word at a time, along any line, and active spans too short for a match are never read.
+		/// </remarks>
+		/// <param name="values">The scanned buffer.</param>
+		/// <param name="project">Projects a buffer value to its match key.</param>
+		/// <param name="activeBits">Activity of the cells, see LineDescriptor.</param>
+		/// <param name="lines">Lines in the buffer.</param>
+		/// <param name="onRun">Called with the line, the first cell and the length of every run.</param>
+		template <typename V, typename Project, typename OnRun>
+		static void ScanLines(const V* values, Project&& project, const std::uint64_t* activeBits, std::span<const LineDescriptor> lines, unsigned int minMatchLength, OnRun&& onRun)
+		{
+			const S minLength = static_cast<S>(std::clamp<unsigned int>(minMatchLength, 1u, std::numeric_limits<S>::max()));
+
+			for (const LineDescriptor& line : lines)
+			{
+				const S lineEnd = line.activeStart + line.length;
+
+				for (S spanStart = FindBit(activeBits, line.activeStart, lineEnd, true); spanStart < lineEnd;)
+				{
+					const S spanEnd = FindBit(activeBits, spanStart, lineEnd, false);
+					const S spanLength = spanEnd - spanStart;
+
+					if (spanLength >= minLength)
+					{
+						const S first = spanStart - line.activeStart;
+						const V* value = values + line.start + first * line.stride;
+						const V* runValue = value;
+						S runStart = first;
+
+						for (S k = first + 1; k < first + spanLength; ++k)
+						{
+							value += line.stride;
+							if (!(std::invoke(project, *value) == std::invoke(project, *runValue)))
+							{
+								if (k - runStart >= minLength)
+									onRun(line, runStart, k - runStart);
+
+								runValue = value;
+								runStart = k;
+							}
+						}
+
+						if (first + spanLength - runStart >= minLength)
+							onRun(line, runStart, first + spanLength - runStart);
+					}
+
+					spanStart = FindBit(activeBits, spanEnd, lineEnd, true);
+				}
+			}
+		}
+
+	public:
+		/// <summary>
+		/// Match groups found one at a time, see EnumerateMatchGroups.
+		/// </summary>
+		/// <remarks>
+		/// The scan stops after every group and carries on when the iterator is incremented,
+		/// like a std::generator. A group is a view of a buffer inside the range, valid until the next increment.
+		/// The table must not change while the range is in use.
+		/// </remarks>
+		class MatchGroupRange
+		{
+		public:
+			class Iterator
+			{
+			public:
+				using value_type = std::span<const MisketPosition>;
+				using difference_type = std::ptrdiff_t;
+
+				Iterator() = default;
+
+				value_type operator*() const
+				{
+					return range->group;
+				}
+
+				Iterator& operator++()
+				{
+					range->Advance();
+					return *this;
+				}
+
+				void operator++(int)
+				{
+					++*this;
+				}
+
+				bool operator==(std::default_sentinel_t) const
+				{
+					return range->done;
+				}
+
+			private:
+				friend MatchGroupRange;
+
+				explicit Iterator(MatchGroupRange* range)
+					: range(range)
+				{
+				}
+
+				MatchGroupRange* range = nullptr;
+			};
+
+			MatchGroupRange(MatchGroupRange&&) = default;
+			MatchGroupRange& operator=(MatchGroupRange&&) = default;
+
+			/// <summary>
+			/// Find the first group. Only call once; the range can't be restarted.
+			/// </summary>
+			Iterator begin()
+			{
+				Advance();
+				return Iterator(this);
+			}
+
+			std::default_sentinel_t end() const
+			{
+				return std::default_sentinel;
+			}
+
+		private:
+			friend Table;
+
+			MatchGroupRange(const Table& table, unsigned int minMatchLength, MatchDirections matchDirections)
+				: table(&table), minMatchLength(minMatchLength), lines(table.scratchResource), group(table.scratchResource)
+			{
+				// Other topologies are gathered up front, their groups are still found one at a time
+				if constexpr (Topology::isSquare)
+				{
+					lines = table.GetInPlaceLineDescriptors(minMatchLength, matchDirections, false);
+				}
+				else
+				{
+					gathered = table.GatherLines(minMatchLength, matchDirections);
+					lines = std::move(gathered.lines);
+				}
+			}
+
+			/// <summary>
+			/// Scan on from where the last group ended, until the next group or the end of the lines.
+			/// </summary>
+			void Advance()
+			{
+				for (; lineIndex < lines.size(); ++lineIndex, cell = 0, runIndex = -1)
+				{
+					const LineDescriptor& line = lines[lineIndex];
+
+					while (cell < line.length)
+					{
+						const S index = line.start + cell * line.stride;
+						const S k = cell++;
+
+						if (!IsActiveAt(line, k))
+						{
+							const bool found = TakeRun(line, k);
+							runIndex = -1;
+
+							// Skip the rest of the hole a mask word at a time
+							cell = FindBit(ActiveBits(), line.activeStart + cell, line.activeStart + line.length, true) - line.activeStart;
+							if (found)
+								return;
+							continue;
+						}
+
+						if (runIndex < 0 || !SameAt(index, runIndex))
+						{
+							const bool found = TakeRun(line, k);
+							runIndex = index;
+							runStart = k;
+							if (found)
+								return;
+						}
+					}
+
+					if (TakeRun(line, line.length))
+					{
+						++lineIndex;
+						cell = 0;
+						runIndex = -1;
+						return;
+					}
+				}
+
+				done = true;
+			}
+
+			/// <summary>
+			/// Activity mask of the lines, see LineDescriptor.
+			/// </summary>
+			const std::uint64_t* ActiveBits() const
+			{
+				if constexpr (Topology::isSquare)
+					return table->lineActiveMask.data();
+				else
+					return gathered.active.data();
+			}
+
+			bool IsActiveAt(const LineDescriptor& line, S k) const
+			{
+				const S bit = line.activeStart + k;
+				return (ActiveBits()[bit >> 6] >> (bit & 63)) & 1u;
+			}
+
+			bool SameAt(S index, S other) const
+			{
+				if constexpr (Topology::isSquare)
+					return SameKey(table->data[index], table->data[other]);
+				else
+					return gathered.values[index] == gathered.values[other];
+			}
+
+			MisketPosition PositionAt(const LineDescriptor& line, S k) const
+			{
+				if constexpr (Topology::isSquare)
+				{
+					return MisketPosition(line.row + k * line.dRow, line.column + k * line.dCol);
+				}
+				else
+				{
+					const S index = gathered.cells[line.start + k];
+					return MisketPosition(index / table->columnCount, index % table->columnCount);
+				}
+			}
+
+			/// <summary>
+			/// Copy the current run into the group if it is long enough.
+			/// </summary>
+			/// <param name="end">Cell after the last misket of the run.</param>
+			/// <returns>True if the run is a group.</returns>
+			bool TakeRun(const LineDescriptor& line, S end)
+			{
+				if (runIndex < 0 || static_cast<unsigned int>(end - runStart) < minMatchLength)
+					return false;
+
+				group.clear();
+				for (S k = runStart; k < end; ++k)
+				{
+					group.push_back(PositionAt(line, k));
+				}
+				return true;
+			}
+
+			const Table* table;
+			unsigned int minMatchLength;
+			std::pmr::vector<LineDescriptor> lines;
+			GatheredLines gathered;
+			MisketMatchGroup group;
+
+			// Where the scan stopped. The run starts at buffer index runIndex, -1 if there is none.
+			size_t lineIndex = 0;
+			S cell = 0;
+			S runStart = 0;
+			S runIndex = -1;
+			bool done = false;
+		};
+
+		/// <summary>
+		/// Find matches in the table one group at a time.
+		/// </summary>
+		/// <remarks>
+		/// Same groups as FindMatchGroups, in the same order, but nothing is scanned until it is asked for,
+		/// so callers that stop early only pay for the lines they read. Diagonals are scanned in place.
+		/// On other topologies than the square grid, the lines are gathered when the range is made.
+		/// </remarks>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>An input range of match groups.</returns>
+		MatchGroupRange EnumerateMatchGroups(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			return MatchGroupRange(*this, minMatchLength, matchDirections);
+		}
+
+		/// <summary>
+		/// Checks if the table has any match. Stops at the first one.
+		/// </summary>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>True if there is at least one match group.</returns>
+		bool HasAnyMatch(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			MatchGroupRange matchGroups = EnumerateMatchGroups(minMatchLength, matchDirections);
+			return matchGroups.begin() != matchGroups.end();
+		}
+
+		/// <summary>
+		/// Find matches in the table on several threads and return as groups of matches.
+		/// </summary>
+		/// <remarks>
+		/// <para>
+		/// The board is split into bands of rows, scanned on the shared ThreadPool and the calling thread.
+		/// Every band runs ScanLines over its rows and over the parts of the columns and diagonals that cross it.
+		/// A run that reaches the bottom of its band is followed into the next bands, and reported by the band of its first misket,
+		/// so runs crossing band borders are found whole, exactly once.
+		/// </para>
+		/// <para>
+		/// Bands only record where their runs are. The groups are built from them after the scan, on the calling thread,
+		/// so they are allocated from the scratch resource directly.
+		/// </para>
+		/// <para>
+		/// The groups are the same as FindMatchGroups, ordered by direction.
+		/// Horizontal and vertical groups are in the same order too, diagonal ones may come in another order.
+		/// Small boards, and boards on other topologies than the square grid, are scanned by FindMatchGroups on the calling thread.
+		/// </para>
+		/// </remarks>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <param name="threadCount">Number of bands to scan at once. 0 uses one per hardware thread.</param>
+		/// <returns>A vector of match groups.</returns>
+		MisketMatchGroups FindMatchGroupsParallel(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections(), unsigned int threadCount = 0) const
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			if constexpr (!Topology::isSquare)
+			{
+				return FindMatchGroups(minMatchLength, matchDirections);
+			}
+
+			if (threadCount == 0)
+			{
+				threadCount = std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			// Below this many cells per band, handing it to a worker costs more than the scan
+			constexpr S minimumBandCells = 1 << 14;
+
+			const S cellCount = static_cast<S>(data.size());
+			const S bandCount = std::max<S>(1, std::min<S>({ static_cast<S>(threadCount), rowCount, cellCount / minimumBandCells }));
+
+			if (bandCount == 1)
+			{
+				return FindMatchGroups(minMatchLength, matchDirections);
+			}
+
+			// A run found by a band, along the line from start
+			struct BandRun
+			{
+				MisketPosition start;
+				S dRow;
+				S dCol;
+				S length;
+			};
+
+			// Scratch resources are not thread safe, bands record their runs in vectors of their own
+			std::vector<std::array<std::vector<BandRun>, 4>> bandRuns(bandCount);
+
+			auto scanBand = [&](S band)
+			{
+				const S firstRow = rowCount * band / bandCount;
+				const S lastRow = rowCount * (band + 1) / bandCount;
+
+				auto addGroup = [&](size_t direction, const LineDescriptor& line, S first, S length)
+				{
+					bandRuns[band][direction].push_back({ MisketPosition(line.row + first * line.dRow, line.column + first * line.dCol), line.dRow, line.dCol, length });
+				};
+
+				// Rows never cross a band border
+				if (matchDirections.horizontal)
+				{
+					for (S row = firstRow; row < lastRow; ++row)
+					{
+						const LineDescriptor line { Index(row, 0), 1, columnCount, row, 0, 0, 1, ActiveBitAlong(row, 0, 0, 1) };
+						ScanLines(data.data(), Key(), lineActiveMask.data(), std::span(&line, 1), minMatchLength,
+							[&](const LineDescriptor&, S first, S length) { addGroup(0, line, first, length); });
+					}
+				}
+
+				// Does the cell at (row, column) continue the run of the one at (row - 1, column - dCol)?
+				auto continuesRun = [&](S row, S column, S dCol)
+				{
+					const S before = column - dCol;
+					return row > 0 && column >= 0 && column < columnCount && before >= 0 && before < columnCount
+						&& IsActiveIndex(Index(row, column)) && IsActiveIndex(Index(row - 1, before))
+						&& SameKey(data[Index(row, column)], data[Index(row - 1, before)]);
+				};
+
+				// The part of a column or diagonal from (row, column) to the bottom of the band
+				auto scanPart = [&](size_t direction, S row, S column, S dCol)
+				{
+					const S length = std::min(lastRow - row, dCol > 0 ? columnCount - column : dCol < 0 ? column + 1 : lastRow - row);
+					const LineDescriptor line { Index(row, column), columnCount + dCol, length, row, column, 1, dCol, ActiveBitAlong(row, column, 1, dCol) };
+
+					const bool fromBandAbove = row == firstRow && continuesRun(row, column, dCol);
+					const S endRow = row + length;
+					const S endColumn = column + length * dCol;
+					const bool intoBandBelow = endRow == lastRow && endRow < rowCount && endColumn >= 0 && endColumn < columnCount;
+
+					// Runs from the band above are theirs, runs into the band below are followed after the scan
+					ScanLines(data.data(), Key(), lineActiveMask.data(), std::span(&line, 1), minMatchLength,
+						[&](const LineDescriptor&, S first, S runLength)
+						{
+							if ((first == 0 && fromBandAbove) || (intoBandBelow && first + runLength == length))
+								return;
+
+							addGroup(direction, line, first, runLength);
+						});
+
+					if (!intoBandBelow || !IsActiveIndex(line.start + (length - 1) * line.stride))
+						return;
+
+					// Find where the last run starts, it may be shorter than a match in this band
+					S first = length - 1;
+					while (first > 0 && continuesRun(row + first, column + first * dCol, dCol))
+					{
+						--first;
+					}
+
+					if (first == 0 && fromBandAbove)
+						return;
+
+					S runLength = length - first;
+					while (row + first + runLength < rowCount && continuesRun(row + first + runLength, column + (first + runLength) * dCol, dCol))
+					{
+						++runLength;
+					}
+
+					if (static_cast<unsigned int>(runLength) >= minMatchLength)
+						addGroup(direction, line, first, runLength);
+				};
+
+				if (matchDirections.vertical)
+				{
+					for (S col = 0; col < columnCount; ++col)
+					{
+						scanPart(1, firstRow, col, 0);
+					}
+				}
+
+				if (matchDirections.diagonal)
+				{
+					// Diagonals cross the top of the band, or start at its left or right edge
+					for (size_t direction = 2; direction < 4; ++direction)
+					{
+						const S dCol = direction == 2 ? 1 : -1;
+						for (S col = 0; col < columnCount; ++col)
+						{
+							scanPart(direction, firstRow, col, dCol);
+						}
+						for (S row = firstRow + 1; row < lastRow; ++row)
+						{
+							scanPart(direction, row, dCol > 0 ? 0 : columnCount - 1, dCol);
+						}
+					}
+				}
+			};
+
+			ThreadPool::GetShared().ParallelFor(static_cast<size_t>(bandCount), [&](size_t band) { scanBand(static_cast<S>(band)); });
+
+			// FindMatchGroups reports vertical groups column by column
+			std::vector<BandRun> verticalRuns;
+			for (const auto& runs : bandRuns)
+			{
+				verticalRuns.insert(verticalRuns.end(), runs[1].begin(), runs[1].end());
+			}
+			std::stable_sort(verticalRuns.begin(), verticalRuns.end(), [](const BandRun& a, const BandRun& b)
+				{
+					return a.start.column < b.start.column;
+				});
+
+			size_t groupCount = verticalRuns.size();
+			for (const auto& runs : bandRuns)
+			{
+				groupCount += runs[0].size() + runs[2].size() + runs[3].size();
+			}
+
+			MisketMatchGroups matchGroups(scratchResource);
+			matchGroups.reserve(groupCount);
+
+			auto addGroups = [&](const std::vector<BandRun>& runs)
+			{
+				for (const BandRun& run : runs)
+				{
+					MisketMatchGroup& group = matchGroups.emplace_back();
+					group.reserve(run.length);
+					for (S k = 0; k < run.length; ++k)
+					{
+						group.emplace_back(run.start.row + k * run.dRow, run.start.column + k * run.dCol);
+					}
+				}
+			};
+
+			for (size_t d = 0; d < 4; ++d)
+			{
+				if (d == 1)
+				{
+					addGroups(verticalRuns);
+					continue;
+				}
+
+				for (const auto& runs : bandRuns)
+				{
+					addGroups(runs[d]);
+				}
+			}
+
+			return matchGroups;
+		}
+
+		/*
+		static std::vector<MisketMatchGroup> MergeOverlappingGroups(const std::vector<MisketMatchGroup>& groups)
+		{
+			using Pos = std::pair<S, S>;
+
+			std::vector<std::set<Pos>> mergedSets;
+
+			for (const auto& group : groups)
+			{
+				std::set<Pos> current(group.begin(), group.end());
+				std::vector<S> overlaps;
+
+				for (S i = 0; i < mergedSets.size(); ++i)
+				{
+					for (const auto& pos : current)
+					{
+						if (mergedSets[i].count(pos))
+						{
+							overlaps.push_back(i);
+							break;
+						}
+					}
+				}
+
+				if (overlaps.empty())
+				{
+					mergedSets.push_back(std::move(current));
+				}
+				else
+				{
+					// Merge all overlapping sets and current into one
+					std::set<Pos> merged = std::move(current);
+					// Merge all overlapping sets
+					std::sort(overlaps.begin(), overlaps.end(), std::greater<>()); // reverse for safe erase
+					for (S index : overlaps)
+					{
+						merged.insert(mergedSets[index].begin(), mergedSets[index].end());
+						mergedSets.erase(mergedSets.begin() + index);
+					}
+					mergedSets.push_back(std::move(merged));
+				}
+			}
+
+			// Convert sets back to vectors
+			std::vector<std::vector<Pos>> result;
+			for (const auto& s : mergedSets)
+				result.emplace_back(s.begin(), s.end());
+
+			return result;
+		}
+		*/
+
+		/// <summary>
+		/// Checks if swapping two elements results in a match.
+		/// </summary>
+		/// <param name="row1">Row of first element</param>
+		/// <param name="col1">Column of first element</param>
+		/// <param name="row2">Row of second element</param>
+		/// <param name="col2">Column of second element</param>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>True if a match would occur after swap</returns>
+		bool WouldSwapCauseMatch(S row1, S col1, S row2, S col2, unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections())
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			// Bounds check
+			if (row1 >= rowCount || row2 >= rowCount || col1 >= columnCount || col2 >= columnCount)
+				return false;
+
+			if (row1 == row2 && col1 == col2)
+				return false;
+
+			// Swap the two elements
+			Swap(row1, col1, row2, col2);
+
+			// Check for matches after the swap, stopping at the first one
+			const bool hasMatch = HasAnyMatch(minMatchLength, matchDirections);
+
+			// Undo the swap
+			Swap(row1, col1, row2, col2);
+
+			return hasMatch;
+		}
+
+		/// <summary>
+		/// Checks if swapping two elements results in a match.
+		/// </summary>
+		/// <param name="pos1">Position of first element</param>
+		/// <param name="pos2">Position of second element</param>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>True if a match would occur after swap</returns>
+		bool WouldSwapCauseMatch(MisketPosition pos1, MisketPosition pos2, unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections())
+		{
+			return WouldSwapCauseMatch(pos1.row, pos1.column, pos2.row, pos2.column, minMatchLength, matchDirections);
+		}
+
+		/// <summary>
+		/// Find a swap that would create a match.
+		/// </summary>
+		/// <remarks>
+		/// The table is not modified. Only the lines through the two swapped cells are checked,
+		/// and the search stops at the first valid move.
+		/// With move tracking enabled for the same arguments, this is a lookup.
+		/// </remarks>
+		/// <param name="pos1">Receives the position of the first misket of the move.</param>
+		/// <param name="pos2">Receives the position of the second misket of the move.</param>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check. Also decides which neighbours can be swapped.</param>
+		/// <returns>True if a valid move was found, false if the board is dead.</returns>
+		bool FindValidMove(MisketPosition& pos1, MisketPosition& pos2, unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			if (IsTrackingMoves(minMatchLength, matchDirections))
+			{
+				UpdateMoveTracker();
+				if (moveTracker.validSlots.empty())
+					return false;
+
+				SlotToSwap(moveTracker.validSlots.front(), pos1, pos2);
+				return true;
+			}
+
+			const S cellCount = static_cast<S>(data.size());
+			for (S slot = 0; slot < cellCount * axisCount; ++slot)
+			{
+				if (IsValidSwap(slot, minMatchLength, matchDirections))
+				{
+					SlotToSwap(slot, pos1, pos2);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		/// <summary>
+		/// Checks if there is at least one swap that would create a match.
+		/// </summary>
+		/// <remarks>
+		/// Returns on the first valid move found. Use this to detect dead boards after a cascade.
+		/// </remarks>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>True if the board has a valid move, false otherwise.</returns>
+		bool HasAnyValidMove(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			MisketPosition pos1, pos2;
+			return FindValidMove(pos1, pos2, minMatchLength, matchDirections);
+		}
+
+		/// <summary>
+		/// Checks if there are at least count swaps that would create a match.
+		/// </summary>
+		/// <remarks>
+		/// Returns as soon as count valid moves are found, so boards with plenty of moves are accepted quickly.
+		/// </remarks>
+		/// <param name="count">Number of valid moves needed.</param>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>True if the board has at least count valid moves.</returns>
+		bool HasValidMoves(S count, unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			if (IsTrackingMoves(minMatchLength, matchDirections))
+			{
+				UpdateMoveTracker();
+				return static_cast<S>(moveTracker.validSlots.size()) >= count;
+			}
+
+			S found = 0;
+			const S cellCount = static_cast<S>(data.size());
+			for (S slot = 0; slot < cellCount * axisCount && found < count; ++slot)
+			{
+				found += IsValidSwap(slot, minMatchLength, matchDirections);
+			}
+			return found >= count;
+		}
+
+		/// <summary>
+		/// Keep a live set of the valid swaps, so dead board checks and hints don't scan the board.
+		/// </summary>
+		/// <remarks>
+		/// Every change to the board records the cells it touched. When the set is read,
+		/// only the swaps near those cells are checked again.
+		/// FindValidMove, HasAnyValidMove and GetValidMoveCount use the set when called with the same arguments.
+		/// 
+		/// References from the non-const accessors count as changes to their cells, written or not.
+		/// </remarks>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		void EnableMoveTracking(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections())
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			std::pmr::memory_resource* resource = GetMemoryResource();
+			moveTracker = MoveTracker { .enabled = true, .minMatchLength = minMatchLength, .matchDirections = matchDirections,
+				.dirtyCells = std::pmr::vector<S>(resource), .validSlots = std::pmr::vector<S>(resource), .slotPositions = std::pmr::vector<S>(resource) };
+		}
+
+		/// <summary>
+		/// Stop tracking the valid swaps and free the set.
+		/// </summary>
+		void DisableMoveTracking()
+		{
+			moveTracker = MoveTracker();
+		}
+
+		/// <summary>
+		/// Is move tracking enabled?
+		/// </summary>
+		/// <returns>True if a live set of valid swaps is kept.</returns>
+		bool IsTrackingMoves() const
+		{
+			return moveTracker.enabled;
+		}
+
+		/// <summary>
+		/// Count the swaps that would create a match.
+		/// </summary>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>The number of valid swaps.</returns>
+		S GetValidMoveCount(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			if (IsTrackingMoves(minMatchLength, matchDirections))
+			{
+				UpdateMoveTracker();
+				return static_cast<S>(moveTracker.validSlots.size());
+			}
+
+			S count = 0;
+			const S cellCount = static_cast<S>(data.size());
+			for (S slot = 0; slot < cellCount * axisCount; ++slot)
+			{
+				count += IsValidSwap(slot, minMatchLength, matchDirections);
+			}
+			return count;
+		}
+
+		/// <summary>
+		/// Swap two elements and return the matches that would occur.
+		/// </summary>
+		/// <remarks>
+		/// Note that this does not check if the swap is valid.
+		/// Match Group returned may be empty.
+		/// </remarks>
+		/// <param name="row1">Row of first element</param>
+		/// <param name="col1">Column of first element</param>
+		/// <param name="row2">Row of second element</param>
+		/// <param name="col2">Column of second element</param>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>Match groups that would occur after the swap</returns>
+		MisketMatchGroups SwapAndGetMatches(S row1, S col1, S row2, S col2, unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections())
+		{
+			BeginEvents();
+			Swap(row1, col1, row2, col2);
+			auto matches = FindMatchGroups(minMatchLength, matchDirections);
+
+			if (matches.empty())
+			{
+				// No matches, undo the swap
+				Swap(row1, col1, row2, col2);
+			}
+			else if (IsRecordingEvents())
+			{
+				RecordEvent(BoardEventType::Swapped, Index(row1, col1), Index(row2, col2));
+				for (size_t group = 0; group < matches.size(); ++group)
+				{
+					for (const auto& pos : matches[group])
+					{
+						RecordEvent(BoardEventType::Matched, Index(pos), Index(pos), static_cast<Scalar>(group));
+					}
+				}
+			}
+
+			PublishEvents();
+			return matches;
+		}
+
+		/// <summary>
+		/// Swap two elements and return the matches that would occur.
+		/// </summary>
+		/// <remarks>
+		/// Note that this does not check if the swap is valid.
+		/// Match Group returned may be empty.
+		/// </remarks>
+		/// <param name="pos1">Position of first element.</param>
+		/// <param name="pos2">Position of second element.</param>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>Match groups that would occur after the swap.</returns>
+		MisketMatchGroups SwapAndGetMatches(MisketPosition pos1, MisketPosition pos2, unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections())
+		{
+			return SwapAndGetMatches(pos1.row, pos1.column, pos2.row, pos2.column, minMatchLength, matchDirections);
+		}
+
+		/// <summary>
+		/// Pop the specified miskets from the table and collapse the lanes towards the gravity direction.
+		/// </summary>
+		/// <remarks>
+		/// Every lane (a column for vertical gravity, a row for horizontal gravity) is compacted in place.
+		/// New miskets are spawned from the opposite edge.
+		/// </remarks>
+		/// <param name="positions">The positions of the miskets to pop.</param>
+		/// <param name="collapseMoves">Receives the falls and spawns of the collapse. Optional.</param>
+		void PopMiskets(std::span<const MisketPosition> positions, CollapseMoves* collapseMoves = nullptr)
+		{
+			BeginEvents();
+			// Let's mark the positions of the miskets to be popped
+			std::pmr::vector<bool> marked(data.size(), false, scratchResource);
+			for (const auto& pos : positions)
+			{
+				if (CheckBounds(pos))
+					marked[Index(pos)] = true;
+			}
+
+			CollapseMarked(marked, collapseMoves);
+			PublishEvents();
+		}
+
+		/// <summary>
+		/// Pop the specified miskets from the table and collapse the columns.
+		/// </summary>
+		/// <remarks>
+		/// All groups are popped together, with a single collapse.
+		/// </remarks>
+		/// <param name="matchGroups">The match groups to pop.</param>
+		/// <param name="collapseMoves">Receives the falls and spawns of the collapse. Optional.</param>
+		void PopMisketMatchGroups(std::span<const MisketMatchGroup> matchGroups, CollapseMoves* collapseMoves = nullptr)
+		{
+			BeginEvents();
+			std::pmr::vector<bool> marked(data.size(), false, scratchResource);
+			for (const auto& group : matchGroups)
+			{
+				for (const auto& pos : group)
+				{
+					if (CheckBounds(pos))
+						marked[Index(pos)] = true;
+				}
+			}
+
+			CollapseMarked(marked, collapseMoves);
+			PublishEvents();
+		}
+
+		/// <summary>
+		/// Pop the miskets at the specified packed positions and collapse the lanes.
+		/// </summary>
+		/// <param name="positions">Any contiguous range of packed positions.</param>
+		/// <param name="collapseMoves">Receives the falls and spawns of the collapse. Optional.</param>
+		template <std::ranges::contiguous_range Positions>
+			requires PackedPositionType<std::ranges::range_value_t<Positions>>
+		void PopMiskets(const Positions& positions, CollapseMoves* collapseMoves = nullptr)
+		{
+			BeginEvents();
+			std::pmr::vector<bool> marked(data.size(), false, scratchResource);
+			for (const auto& pos : positions)
+			{
+				if (CheckBounds(pos))
+					marked[pos.index] = true;
+			}
+
+			CollapseMarked(marked, collapseMoves);
+			PublishEvents();
+		}
+
+		/// <summary>
+		/// Pop the specified packed match groups together, with a single collapse.
+		/// </summary>
+		/// <param name="matchGroups">Any contiguous range of packed match groups.</param>
+		/// <param name="collapseMoves">Receives the falls and spawns of the collapse. Optional.</param>
+		template <std::ranges::contiguous_range Groups>
+			requires PackedPositionType<std::ranges::range_value_t<std::ranges::range_value_t<Groups>>>
+		void PopMisketMatchGroups(const Groups& matchGroups, CollapseMoves* collapseMoves = nullptr)
+		{
+			BeginEvents();
+			std::pmr::vector<bool> marked(data.size(), false, scratchResource);
+			for (const auto& group : matchGroups)
+			{
+				for (const auto& pos : group)
+				{
+					if (CheckBounds(pos))
+						marked[pos.index] = true;
+				}
+			}
+
+			CollapseMarked(marked, collapseMoves);
+			PublishEvents();
+		}
+
+		/// <summary>
+		/// Resolve one cascade step: create special miskets from the matches,
+		/// set off every special misket that gets cleared, then collapse once.
+		/// </summary>
+		/// <remarks>
+		/// <para>
+		/// A match of 5 or more creates a colour bomb, two crossing matches (L and T shapes) create a bomb,
+		/// and a match of 4 creates a line clearer. The new special misket keeps its colour and is not cleared.
+		/// It is placed on the moved misket if that is part of the match, otherwise in the middle of the match.
+		/// </para>
+		/// <para>
+		/// All effects are collected into one clear mask. Special miskets hit by other effects go off too,
+		/// through a work list instead of recursion, so any chain costs a single collapse.
+		/// </para>
+		/// </remarks>
+		/// <param name="matchGroups">The match groups of this step.</param>
+		/// <param name="movedPositions">Positions the player just moved. Empty for cascades.</param>
+		/// <param name="collapseMoves">Receives the falls and spawns of the collapse. Optional.</param>
+		/// <returns>What was cleared and created.</returns>
+		ClearResult ResolveMatchGroups(std::span<const MisketMatchGroup> matchGroups, std::span<const MisketPosition> movedPositions = {}, CollapseMoves* collapseMoves = nullptr)
+		{
+			BeginEvents();
+			ClearResult result { .cleared = MisketMatchGroup(scratchResource), .created = std::pmr::vector<std::pair<MisketPosition, SpecialMisket>>(scratchResource) };
+			const S cellCount = static_cast<S>(data.size());
+
+			std::pmr::vector<bool> marked(cellCount, false, scratchResource);
+			std::pmr::vector<S> triggered(scratchResource);
+
+			auto mark = [&](S index)
+			{
+				if (marked[index] || !IsActiveIndex(index))
+					return;
+
+				marked[index] = true;
+				if (specials[index] != SpecialMisket::None)
+					triggered.push_back(index);
+			};
+
+			for (const auto& group : matchGroups)
+			{
+				for (const auto& pos : group)
+				{
+					if (CheckBounds(pos))
+						mark(Index(pos));
+				}
+			}
+
+			result.created = FindSpecialPlacements(matchGroups, movedPositions);
+
+			// Set off special miskets. Anything they hit is appended to the same list.
+			for (size_t i = 0; i < triggered.size(); ++i)
+			{
+				const S index = triggered[i];
+				const S row = index / columnCount;
+				const S col = index % columnCount;
+
+				switch (specials[index])
+				{
+				case SpecialMisket::RowClearer:
+					for (S c = 0; c < columnCount; ++c)
+						mark(Index(row, c));
+					break;
+
+				case SpecialMisket::ColumnClearer:
+					for (S r = 0; r < rowCount; ++r)
+						mark(Index(r, col));
+					break;
+
+				case SpecialMisket::Bomb:
+					for (S r = std::max<S>(row - 1, 0); r <= std::min<S>(row + 1, rowCount - 1); ++r)
+						for (S c = std::max<S>(col - 1, 0); c <= std::min<S>(col + 1, columnCount - 1); ++c)
+							mark(Index(r, c));
+					break;
+
+				case SpecialMisket::ColourBomb:
+					for (S other = 0; other < cellCount; ++other)
+					{
+						if (SameKey(data[other], data[index]))
+							mark(other);
+					}
+					break;
+
+				default:
+					break;
+				}
+			}
+
+			result.triggeredCount = static_cast<S>(triggered.size());
+
+			// New special miskets stay on the board
+			for (const auto& [pos, special] : result.created)
+			{
+				marked[Index(pos)] = false;
+				specials[Index(pos)] = special;
+			}
+
+			for (S index = 0; index < cellCount; ++index)
+			{
+				if (marked[index])
+					result.cleared.emplace_back(index / columnCount, index % columnCount);
+			}
+
+			CollapseMarked(marked, collapseMoves);
+			PublishEvents();
+			UpdateSpawnWeights(result);
+			return result;
+		}
+
+		/// <summary>
+		/// Resolve one cascade step from packed match groups. See ResolveMatchGroups.
+		/// </summary>
+		/// <param name="matchGroups">The packed match groups of this step.</param>
+		/// <param name="movedPositions">Positions the player just moved. Empty for cascades.</param>
+		/// <param name="collapseMoves">Receives the falls and spawns of the collapse. Optional.</param>
+		/// <returns>What was cleared and created.</returns>
+		template <std::ranges::contiguous_range Groups>
+			requires PackedPositionType<std::ranges::range_value_t<std::ranges::range_value_t<Groups>>>
+		ClearResult ResolveMatchGroups(const Groups& matchGroups, std::span<const MisketPosition> movedPositions = {}, CollapseMoves* collapseMoves = nullptr)
+		{
+			// Shapes are checked on rows and columns, so unpack into scratch memory first
+			MisketMatchGroups unpacked(scratchResource);
+			unpacked.reserve(matchGroups.size());
+			for (const auto& group : matchGroups)
+			{
+				auto& positions = unpacked.emplace_back();
+				positions.reserve(group.size());
+				for (const auto& pos : group)
+				{
+					positions.push_back(Unpack(pos));
+				}
+			}
+
+			return ResolveMatchGroups(std::span<const MisketMatchGroup>(unpacked), movedPositions, collapseMoves);
+		}
+
+	private:
+		/// <summary>
+		/// Memory layout of the lanes miskets fall along.
+		/// Cell k of a lane is at origin + lane * laneStride + k * step,
+		/// where k = 0 is the edge miskets fall to.
+		/// </summary>
+		struct LaneLayout
+		{
+			S laneCount;
+			S laneLength;
+			S origin;
+			S laneStride;
+			S step;
+
+			/// <summary>
+			/// Are the lanes columns?
+			/// </summary>
+			bool vertical;
+
+			S CellIndex(S lane, S k) const
+			{
+				return origin + lane * laneStride + k * step;
+			}
+		};
+
+		/// <summary>
+		/// Get the lane layout for the current gravity.
+		/// </summary>
+		/// <returns>The lane layout.</returns>
+		LaneLayout GetLaneLayout() const
+		{
+			switch (gravity)
+			{
+			case Gravity::Up:		return { columnCount, rowCount, 0, 1, columnCount, true };
+			case Gravity::Left:		return { rowCount, columnCount, 0, columnCount, 1, false };
+			case Gravity::Right:	return { rowCount, columnCount, columnCount - 1, columnCount, -1, false };
+			case Gravity::Down:
+			default:				return { columnCount, rowCount, Index(rowCount - 1, 0), 1, -columnCount, true };
+			}
+		}
+
+		/// <summary>
+		/// Decide which special miskets the match groups create, and where.
+		/// </summary>
+		/// <param name="matchGroups">The match groups.</param>
+		/// <param name="movedPositions">Positions the player just moved.</param>
+		/// <returns>Positions and types of the new special miskets.</returns>
+		std::pmr::vector<std::pair<MisketPosition, SpecialMisket>> FindSpecialPlacements(std::span<const MisketMatchGroup> matchGroups, std::span<const MisketPosition> movedPositions) const
+		{
+			std::pmr::vector<std::pair<MisketPosition, SpecialMisket>> created(scratchResource);
+			std::pmr::vector<bool> used(matchGroups.size(), false, scratchResource);
+			std::pmr::vector<bool> taken(data.size(), false, scratchResource);
+
+			auto place = [&](MisketPosition pos, SpecialMisket special)
+			{
+				if (!taken[Index(pos)])
+				{
+					taken[Index(pos)] = true;
+					created.emplace_back(pos, special);
+				}
+			};
+
+			// The moved misket if it is in the group, otherwise the middle one
+			auto anchorOf = [&](const MisketMatchGroup& group)
+			{
+				for (const auto& pos : group)
+				{
+					if (std::find(movedPositions.begin(), movedPositions.end(), pos) != movedPositions.end())
+						return pos;
+				}
+				return group[group.size() / 2];
+			};
+
+			// Match of 5 or more
+			for (size_t g = 0; g < matchGroups.size(); ++g)
+			{
+				if (matchGroups[g].size() >= 5)
+				{
+					used[g] = true;
+					place(anchorOf(matchGroups[g]), SpecialMisket::ColourBomb);
+				}
+			}
+
+			// L and T shapes: two groups sharing a misket
+			std::pmr::vector<S> owner(data.size(), -1, scratchResource);
+			for (size_t g = 0; g < matchGroups.size(); ++g)
+			{
+				for (const auto& pos : matchGroups[g])
+				{
+					if (!CheckBounds(pos))
+						continue;
+
+					S& first = owner[Index(pos)];
+					if (first >= 0 && !used[first] && !used[g])
+					{
+						used[first] = true;
+						used[g] = true;
+						place(pos, SpecialMisket::Bomb);
+					}
+					else if (first < 0)
+					{
+						first = static_cast<S>(g);
+					}
+				}
+			}
+
+			// Match of 4, the clearer goes across the match
+			for (size_t g = 0; g < matchGroups.size(); ++g)
+			{
+				const auto& group = matchGroups[g];
+				if (used[g] || group.size() != 4)
+					continue;
+
+				const bool horizontal = group[0].row == group[1].row;
+				place(anchorOf(group), horizontal ? SpecialMisket::ColumnClearer : SpecialMisket::RowClearer);
+			}
+
+			return created;
+		}
+
+		/// <summary>
+		/// Find the next active cell of a lane.
+		/// </summary>
+		/// <param name="lanes">The lane layout.</param>
+		/// <param name="lane">The lane index.</param>
+		/// <param name="k">The cell to start from, counted from the gravity edge.</param>
+		/// <returns>The first active cell at or after k, or the lane length if there is none.</returns>
+		S NextActiveInLane(const LaneLayout& lanes, S lane, S k) const
+		{
+			// Rows are contiguous in activeMask, and columns in lineActiveMask, forwards or backwards
+			const std::uint64_t* mask = activeMask.data();
+			S first = lanes.CellIndex(lane, 0);
+
+			if (lanes.vertical)
+			{
+				if (!Topology::isSquare)
+				{
+					while (k < lanes.laneLength && !IsActiveIndex(lanes.CellIndex(lane, k)))
+					{
+						++k;
+					}
+					return k;
+				}
+
+				mask = lineActiveMask.data();
+				first = ActiveBitAlong(first / columnCount, first % columnCount, 1, 0);
+			}
+
+			if (lanes.step > 0)
+				return FindBit(mask, first + k, first + lanes.laneLength, true) - first;
+
+			return first - FindLastBit(mask, first - k, first - lanes.laneLength + 1, true);
+		}
+
+		/// <summary>
+		/// Make a queue for every lane, unless the lanes still have the same shape.
+		/// Called whenever the size or gravity changes, the collapse only reads the queues.
+		/// </summary>
+		void PrepareRefillQueues(const LaneLayout& lanes)
+		{
+			const S queueLength = std::max<S>(lanes.laneLength, 8);
+			if (static_cast<S>(refillHeads.size()) == lanes.laneCount && refillQueueLength == queueLength)
+				return;
+
+			refillQueueLength = queueLength;
+			refillQueues.resize(static_cast<size_t>(lanes.laneCount) * queueLength);
+
+			// Empty queues, filled on first use
+			refillHeads.assign(lanes.laneCount, queueLength);
+		}
+
+		/// <summary>
+		/// Take the next spawn of a lane, filling its queue when it runs out.
+		/// </summary>
+		T NextRefill(S lane)
+		{
+			T* queue = &refillQueues[static_cast<size_t>(lane) * refillQueueLength];
+			S& head = refillHeads[lane];
+
+			if (head == refillQueueLength)
+			{
+				GenerateRandomMiskets({ queue, static_cast<size_t>(refillQueueLength) });
+				head = 0;
+			}
+
+			return queue[head++];
+		}
+
+		/// <summary>
+		/// Build the alias table of the spawn weights with Vose's method.
+		/// </summary>
+		/// <param name="total">Sum of the weights.</param>
+		void BuildAliasTable(double total)
+		{
+			const size_t valueCount = spawnWeights.size();
+			aliasThresholds.assign(valueCount, 0);
+			aliasIndices.resize(valueCount);
+
+			// Scale so the average weight is 1, then pair every light value with a heavy one
+			std::pmr::vector<double> scaled(valueCount, scratchResource);
+			std::pmr::vector<std::uint32_t> light(scratchResource);
+			std::pmr::vector<std::uint32_t> heavy(scratchResource);
+			for (std::uint32_t i = 0; i < valueCount; ++i)
+			{
+				scaled[i] = spawnWeights[i] * valueCount / total;
+				(scaled[i] < 1.0 ? light : heavy).push_back(i);
+			}
+
+			while (!light.empty() && !heavy.empty())
+			{
+				const std::uint32_t small = light.back();
+				const std::uint32_t large = heavy.back();
+				light.pop_back();
+
+				aliasThresholds[small] = static_cast<std::uint64_t>(scaled[small] * 4294967296.0);
+				aliasIndices[small] = large;
+
+				scaled[large] -= 1.0 - scaled[small];
+				if (scaled[large] < 1.0)
+				{
+					heavy.pop_back();
+					light.push_back(large);
+				}
+			}
+
+			// What's left is full, up to rounding errors
+			for (const std::uint32_t i : light)
+			{
+				aliasThresholds[i] = std::uint64_t(1) << 32;
+				aliasIndices[i] = i;
+			}
+			for (const std::uint32_t i : heavy)
+			{
+				aliasThresholds[i] = std::uint64_t(1) << 32;
+				aliasIndices[i] = i;
+			}
+		}
+
+		/// <summary>
+		/// Draw a weighted value index from 64 random bits. The high half picks a column of the alias table, the low half flips its coin.
+		/// </summary>
+		std::uint32_t DrawWeightedIndex(std::uint64_t bits) const
+		{
+			const std::uint32_t column = static_cast<std::uint32_t>(((bits >> 32) * aliasIndices.size()) >> 32);
+			return (bits & 0xFFFFFFFFu) < aliasThresholds[column] ? column : aliasIndices[column];
+		}
+
+		/// <summary>
+		/// Let the spawn weight controller react to a cascade step.
+		/// </summary>
+		void UpdateSpawnWeights(const ClearResult& result)
+		{
+			if (!spawnWeightController)
+				return;
+
+			std::pmr::vector<double> weights(scratchResource);
+			if (spawnWeights.empty())
+				weights.assign(possibleValues.size(), 1.0);
+			else
+				weights.assign(spawnWeights.begin(), spawnWeights.end());
+
+			if (spawnWeightController(result, weights))
+				SetSpawnWeights(weights);
+		}
+
+		/// <summary>
+		/// Remove the marked miskets, let the others fall towards the gravity direction
+		/// and spawn new miskets from the opposite edge.
+		/// </summary>
+		/// <remarks>
+		/// Each lane is compacted in place with a read and a write cursor.
+		/// Column lanes are swept row by row, so both gravity axes walk memory contiguously.
+		/// 
+		/// Holes are skipped, miskets fall through them to the next active cell.
+		/// </remarks>
+		/// <param name="marked">Cells to remove, indexed like the data vector.</param>
+		/// <param name="collapseMoves">Receives the falls and spawns, written during the compaction. Optional.</param>
+		void CollapseMarked(const std::pmr::vector<bool>& marked, CollapseMoves* collapseMoves = nullptr)
+		{
+			const LaneLayout lanes = GetLaneLayout();
+			const bool recording = IsRecordingEvents();
+
+			if (collapseMoves)
+			{
+				collapseMoves->falls.clear();
+				collapseMoves->spawns.clear();
+			}
+
+			if (recording)
+			{
+				for (S index = 0; index < static_cast<S>(data.size()); ++index)
+				{
+					if (marked[index] && IsActiveIndex(index))
+						RecordEvent(BoardEventType::Cleared, index, index);
+				}
+			}
+
+			// Next free cell of every lane, counted from the gravity edge
+			std::pmr::vector<S> write(lanes.laneCount, scratchResource);
+			for (S lane = 0; lane < lanes.laneCount; ++lane)
+			{
+				write[lane] = NextActiveInLane(lanes, lane, 0);
+			}
+
+			auto compact = [&](S lane, S k)
+			{
+				const S read = lanes.CellIndex(lane, k);
+				if (marked[read] || !IsActiveIndex(read))
+					return;
+
+				S& w = write[lane];
+				if (w != k)
+				{
+					data[lanes.CellIndex(lane, w)] = std::move(data[read]);
+					specials[lanes.CellIndex(lane, w)] = specials[read];
+					if constexpr (hasPayload)
+					{
+						payloads[lanes.CellIndex(lane, w)] = std::move(payloads[read]);
+					}
+					MarkChanged(lanes.CellIndex(lane, w));
+
+					if (recording)
+						RecordEvent(BoardEventType::Moved, read, lanes.CellIndex(lane, w));
+
+					if (collapseMoves)
+						collapseMoves->falls.push_back({ PackedMisketPosition(read), PackedMisketPosition(lanes.CellIndex(lane, w)) });
+				}
+				w = NextActiveInLane(lanes, lane, w + 1);
+			};
+
+			if (lanes.vertical)
+			{
+				for (S k = 0; k < lanes.laneLength; ++k)
+				{
+					for (S lane = 0; lane < lanes.laneCount; ++lane)
+					{
+						compact(lane, k);
+					}
+				}
+			}
+			else
+			{
+				for (S lane = 0; lane < lanes.laneCount; ++lane)
+				{
+					for (S k = 0; k < lanes.laneLength; ++k)
+					{
+						compact(lane, k);
+					}
+				}
+			}
+
+			// Spawn new miskets at the opposite edge
+			for (S lane = 0; lane < lanes.laneCount; ++lane)
+			{
+				for (S k = write[lane]; k < lanes.laneLength; k = NextActiveInLane(lanes, lane, k + 1))
+				{
+					data[lanes.CellIndex(lane, k)] = NextRefill(lane);
+					specials[lanes.CellIndex(lane, k)] = SpecialMisket::None;
+					if constexpr (hasPayload)
+					{
+						payloads[lanes.CellIndex(lane, k)] = Payload();
+					}
+					MarkChanged(lanes.CellIndex(lane, k));
+
+					if (recording)
+						RecordEvent(BoardEventType::Spawned, lanes.CellIndex(lane, k), lanes.CellIndex(lane, k));
+
+					if (collapseMoves)
+						collapseMoves->spawns.push_back({ PackedMisketPosition(lanes.CellIndex(lane, k)), data[lanes.CellIndex(lane, k)] });
+				}
+			}
+		}
+
+		bool IsRecordingEvents() const
+		{
+			return recordEvents || eventObserver;
+		}
+
+		/// <summary>
+		/// Start the events of a new operation.
+		/// </summary>
+		void BeginEvents()
+		{
+			events.clear();
+		}
+
+		void RecordEvent(BoardEventType type, S from, S to, Scalar group = -1)
+		{
+			events.push_back({ type, MisketPosition(from / columnCount, from % columnCount), MisketPosition(to / columnCount, to % columnCount), group });
+		}
+
+		/// <summary>
+		/// Pass the events of the operation to the observer.
+		/// </summary>
+		void PublishEvents()
+		{
+			if (eventObserver && !events.empty())
+				eventObserver(events);
+		}
+
+		/// <summary>
+		/// Build the neighbour and line tables of the topology for the current size.
+		/// </summary>
+		void BuildTopology()
+		{
+			if constexpr (!Topology::isSquare)
+			{
+				std::pmr::memory_resource* resource = GetMemoryResource();
+				const S cellCount = static_cast<S>(data.size());
+
+				topology.next = std::pmr::vector<S>(static_cast<size_t>(cellCount) * axisCount, -1, resource);
+				topology.previous = std::pmr::vector<S>(static_cast<size_t>(cellCount) * axisCount, -1, resource);
+				topology.lineCells = std::pmr::vector<S>(resource);
+				topology.lines = std::pmr::vector<TopologyLine>(resource);
+				topology.lineCells.reserve(static_cast<size_t>(cellCount) * axisCount);
+
+				for (S index = 0; index < cellCount; ++index)
+				{
+					for (int axis = 0; axis < axisCount; ++axis)
+					{
+						for (const bool forward : { true, false })
+						{
+							S row = index / columnCount;
+							S column = index % columnCount;
+							if (Topology::Step(rowCount, columnCount, row, column, axis, forward))
+								(forward ? topology.next : topology.previous)[index * axisCount + axis] = Index(row, column);
+						}
+					}
+				}
+
+				// Every cell is on one line per axis. A line is found from its lowest cell,
+				// and starts at its edge, or at that cell if it is a cycle.
+				std::pmr::vector<bool> visited(scratchResource);
+				for (int axis = 0; axis < axisCount; ++axis)
+				{
+					visited.assign(cellCount, false);
+					for (S index = 0; index < cellCount; ++index)
+					{
+						if (visited[index])
+							continue;
+
+						S start = index;
+						bool cyclic = false;
+						for (S cell = topology.previous[index * axisCount + axis]; cell >= 0; cell = topology.previous[cell * axisCount + axis])
+						{
+							if (cell == index)
+							{
+								cyclic = true;
+								start = index;
+								break;
+							}
+							start = cell;
+						}
+
+						const S lineStart = static_cast<S>(topology.lineCells.size());
+						S cell = start;
+						do
+						{
+							topology.lineCells.push_back(cell);
+							visited[cell] = true;
+							cell = topology.next[cell * axisCount + axis];
+						} while (cell >= 0 && cell != start);
+
+						topology.lines.push_back({ lineStart, static_cast<S>(topology.lineCells.size()) - lineStart, axis, cyclic });
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// Is an axis of the topology switched on by the match directions?
+		/// </summary>
+		static bool IsAxisEnabled(int axis, MatchDirections matchDirections)
+		{
+			switch (Topology::axes[axis])
+			{
+			case MatchAxis::Horizontal:
+				return matchDirections.horizontal;
+			case MatchAxis::Vertical:
+				return matchDirections.vertical;
+			default:
+				return matchDirections.diagonal;
+			}
+		}
+
+		/// <summary>
+		/// Record a changed cell for the dirty lines and move tracking.
+		/// </summary>
+		/// <param name="index">Index of the cell in the data vector.</param>
+		void MarkChanged(S index) const
+		{
+			const S row = index / columnCount;
+			const S column = index - row * columnCount;
+			DirtyLines::Set(dirtyLines.rows, row);
+			DirtyLines::Set(dirtyLines.columns, column);
+			DirtyLines::Set(dirtyLines.downRight, column - row + rowCount - 1);
+			DirtyLines::Set(dirtyLines.downLeft, row + column);
+
+			if (!moveTracker.enabled || moveTracker.allDirty)
+				return;
+
+			// Keeps the list bounded when the set isn't read for a long time
+			if (moveTracker.dirtyCells.size() >= data.size())
+			{
+				MarkAllChanged();
+				return;
+			}
+
+			moveTracker.dirtyCells.push_back(index);
+		}
+
+		void MarkRowChanged(S row) const
+		{
+			for (S col = 0; col < columnCount; ++col)
+			{
+				MarkChanged(Index(row, col));
+			}
+		}
+
+		void MarkAllChanged() const
+		{
+			const S diagonalCount = (rowCount > 0 && columnCount > 0) ? rowCount + columnCount - 1 : 0;
+			auto markAll = [](std::pmr::vector<std::uint64_t>& lines, S lineCount)
+			{
+				lines.assign((lineCount + 63) / 64, ~std::uint64_t(0));
+			};
+
+			markAll(dirtyLines.rows, rowCount);
+			markAll(dirtyLines.columns, columnCount);
+			markAll(dirtyLines.downRight, diagonalCount);
+			markAll(dirtyLines.downLeft, diagonalCount);
+
+			moveTracker.allDirty = true;
+			moveTracker.dirtyCells.clear();
+		}
+
+		bool IsTrackingMoves(unsigned int minMatchLength, MatchDirections matchDirections) const
+		{
+			const MatchDirections& tracked = moveTracker.matchDirections;
+			return moveTracker.enabled && moveTracker.minMatchLength == minMatchLength &&
+				tracked.horizontal == matchDirections.horizontal && tracked.vertical == matchDirections.vertical && tracked.diagonal == matchDirections.diagonal;
+		}
+
+		/// <summary>
+		/// Bring the valid swap set up to date with the recorded changes.
+		/// </summary>
+		void UpdateMoveTracker() const
+		{
+			MoveTracker& tracker = moveTracker;
+			const S cellCount = static_cast<S>(data.size());
+
+			auto refresh = [&](S slot)
+			{
+				const bool valid = IsValidSwap(slot, tracker.minMatchLength, tracker.matchDirections);
+				S& position = tracker.slotPositions[slot];
+
+				if (valid && position < 0)
+				{
+					position = static_cast<S>(tracker.validSlots.size());
+					tracker.validSlots.push_back(slot);
+				}
+				else if (!valid && position >= 0)
+				{
+					// Swap-remove, order doesn't matter
+					const S last = tracker.validSlots.back();
+					tracker.validSlots[position] = last;
+					tracker.slotPositions[last] = position;
+					tracker.validSlots.pop_back();
+					position = -1;
+				}
+			};
+
+			if (!tracker.allDirty && !tracker.dirtyCells.empty())
+			{
+				// Past this many changes, rechecking the slots near each one costs more than recounting every slot
+				if (tracker.dirtyCells.size() * RecheckSlotsPerChange() >= static_cast<size_t>(cellCount) * axisCount)
+					tracker.allDirty = true;
+			}
+
+			if (tracker.allDirty)
+			{
+				tracker.validSlots.clear();
+				tracker.slotPositions.assign(static_cast<size_t>(cellCount) * axisCount, -1);
+				for (S slot = 0; slot < cellCount * axisCount; ++slot)
+				{
+					refresh(slot);
+				}
+
+				tracker.allDirty = false;
+				tracker.dirtyCells.clear();
+				return;
+			}
+
+			if (tracker.dirtyCells.empty())
+				return;
+
+			std::pmr::vector<S> recheck(scratchResource);
+			recheck.reserve(tracker.dirtyCells.size() * RecheckSlotsPerChange());
+
+			if constexpr (Topology::isSquare)
+			{
+				// A swap only reads the lines of the match directions through its two cells, up to a match length minus one away.
+				// So a change only reaches the slots with a cell that close on one of the changed cell's lines.
+				const S reach = std::max<S>(static_cast<S>(tracker.minMatchLength), 1) - 1;
+				for (const S index : tracker.dirtyCells)
+				{
+					const S row = index / columnCount;
+					const S col = index % columnCount;
+
+					for (int lineAxis = 0; lineAxis < axisCount; ++lineAxis)
+					{
+						if (!IsAxisEnabled(lineAxis, tracker.matchDirections))
+							continue;
+
+						for (S k = -reach; k <= reach; ++k)
+						{
+							const S r = row + k * SquareTopology::steps[lineAxis][0];
+							const S c = col + k * SquareTopology::steps[lineAxis][1];
+							if (!CheckBounds(r, c))
+								continue;
+
+							// Slots of other axes are never valid
+							for (int axis = 0; axis < axisCount; ++axis)
+							{
+								if (!IsAxisEnabled(axis, tracker.matchDirections))
+									continue;
+
+								// The slot starting here, and the one ending here
+								recheck.push_back(Index(r, c) * axisCount + axis);
+								if (CheckBounds(r - SquareTopology::steps[axis][0], c - SquareTopology::steps[axis][1]))
+									recheck.push_back(Index(r - SquareTopology::steps[axis][0], c - SquareTopology::steps[axis][1]) * axisCount + axis);
+							}
+						}
+					}
+				}
+			}
+			else
+			{
+				// A swap reads the lines through both of its cells, up to a match length away.
+				// Its first cell is next to the second, so it is at most minMatchLength away from any cell it reads.
+				// Walk out that many steps through the neighbour tables, one layer at a time.
+				const S reach = static_cast<S>(tracker.minMatchLength);
+				std::pmr::vector<S> cells(tracker.dirtyCells.begin(), tracker.dirtyCells.end(), scratchResource);
+				size_t layerBegin = 0;
+				for (S distance = 0; distance < reach; ++distance)
+				{
+					const size_t layerEnd = cells.size();
+					for (size_t i = layerBegin; i < layerEnd; ++i)
+					{
+						const S* neighbours[] = { &topology.next[cells[i] * axisCount], &topology.previous[cells[i] * axisCount] };
+						for (const S* next : neighbours)
+						{
+							std::copy_if(next, next + axisCount, std::back_inserter(cells), [](S cell) { return cell >= 0; });
+						}
+					}
+
+					std::sort(cells.begin() + layerEnd, cells.end());
+					cells.erase(std::unique(cells.begin() + layerEnd, cells.end()), cells.end());
+					layerBegin = layerEnd;
+				}
+
+				for (const S index : cells)
+				{
+					for (S axis = 0; axis < axisCount; ++axis)
+					{
+						recheck.push_back(index * axisCount + axis);
+					}
+				}
+			}
+			tracker.dirtyCells.clear();
+
+			// Changed cells are usually close together, check their shared slots once
+			std::sort(recheck.begin(), recheck.end());
+			recheck.erase(std::unique(recheck.begin(), recheck.end()), recheck.end());
+
+			for (const S slot : recheck)
+			{
+				refresh(slot);
+			}
+		}
+
+		/// <summary>
+		/// Most slots UpdateMoveTracker rechecks for one changed cell.
+		/// </summary>
+		size_t RecheckSlotsPerChange() const
+		{
+			const size_t reach = std::max(moveTracker.minMatchLength, 1u);
+			if constexpr (Topology::isSquare)
+			{
+				size_t enabledAxes = 0;
+				for (int axis = 0; axis < axisCount; ++axis)
+				{
+					enabledAxes += IsAxisEnabled(axis, moveTracker.matchDirections);
+				}
+
+				// Two slots per enabled axis, at every cell of every line through the change
+				return enabledAxes * (2 * reach - 1) * enabledAxes * 2;
+			}
+			else
+			{
+				// The neighbourhood walked out, as if on the square grid
+				return (2 * reach + 1) * (2 * reach + 1) * axisCount;
+			}
+		}
+
+		/// <summary>
+		/// The cells of a swap slot. The second cell is the next one along the slot's axis, so every swap has one slot.
+		/// </summary>
+		void SlotToSwap(S slot, MisketPosition& pos1, MisketPosition& pos2) const
+		{
+			const S index = slot / axisCount;
+			const int axis = slot % axisCount;
+			pos1 = MisketPosition(index / columnCount, index % columnCount);
+
+			if constexpr (Topology::isSquare)
+			{
+				pos2 = MisketPosition(pos1.row + SquareTopology::steps[axis][0], pos1.column + SquareTopology::steps[axis][1]);
+			}
+			else
+			{
+				const S other = topology.next[slot];
+				pos2 = MisketPosition(other / columnCount, other % columnCount);
+			}
+		}
+
+		/// <summary>
+		/// Would the swap of a slot create a match? The table is not modified.
+		/// </summary>
+		/// <param name="slot">Cell index * axisCount + axis of the step to the other cell.</param>
+		/// <returns>True if the swap is a valid move.</returns>
+		bool IsValidSwap(S slot, unsigned int minMatchLength, MatchDirections matchDirections) const
+		{
+			const int axis = slot % axisCount;
+			if (!IsAxisEnabled(axis, matchDirections))
+				return false;
+
+			if constexpr (!Topology::isSquare)
+			{
+				// Not a swap past an edge, with itself, or the second slot of two cells that are next to each other both ways
+				const S index = slot / axisCount;
+				const S other = topology.next[slot];
+				if (other < 0 || other == index || (other < index && topology.next[other * axisCount + axis] == index))
+					return false;
+			}
+
+			MisketPosition first, second;
+			SlotToSwap(slot, first, second);
+
+			if (!IsActive(first) || !IsActive(second))
+				return false;
+
+			const T& firstValue = data[Index(first)];
+			const T& secondValue = data[Index(second)];
+
+			if (SameKey(firstValue, secondValue))
+				return false;
+
+			auto swapped = [&](S r, S c) -> const T*
+			{
+				if (r == first.row && c == first.column)
+					return &secondValue;
+				if (r == second.row && c == second.column)
+					return &firstValue;
+				return IsActiveIndex(Index(r, c)) ? &data[Index(r, c)] : nullptr;
+			};
+
+			return FormsMatchAt(first.row, first.column, secondValue, minMatchLength, matchDirections, swapped) ||
+				FormsMatchAt(second.row, second.column, firstValue, minMatchLength, matchDirections, swapped);
+		}
+
+		/// <summary>
+		/// Get the key a misket is matched by.
+		/// </summary>
+		static decltype(auto) KeyOf(const T& value)
+		{
+			return std::invoke(Key(), value);
+		}
+
+		/// <summary>
+		/// Do two miskets match?
+		/// </summary>
+		static bool SameKey(const T& first, const T& second)
+		{
+			return KeyOf(first) == KeyOf(second);
+		}
+
+		/// <summary>
+		/// Get the index of a misket in the data vector based on its row and column.
+		/// </summary>
+		/// <param name="row">Row index</param>
+		/// <param name="column">Column index</param>
+		/// <returns>The index of the misket in the data vector.</returns>
+		S Index(S row, S column) const
+		{
+			return row * columnCount + column;
+		}
+
+		/// <summary>
+		/// Get the index of a misket in the data vector based on its position.
+		/// </summary>
+		/// <param name="pos">The position of the misket.</param>
+		/// <returns>The index of the misket in the data vector.</returns>
+		S Index(MisketPosition pos) const
+		{
+			return pos.row * columnCount + pos.column;
+		}
+
+		/// <summary>
+		/// Is the cell at the given data index active?
+		/// </summary>
+		/// <param name="index">Index in the data vector.</param>
+		/// <returns>True if the cell is active.</returns>
+		bool IsActiveIndex(S index) const
+		{
+			return (activeMask[index >> 6] >> (index & 63)) & 1u;
+		}
+
+		/// <summary>
+		/// Find the first bit in [index, end) of a mask that is set, or clear, a whole word at a time.
+		/// </summary>
+		/// <param name="mask">The mask, bit i is bit i % 64 of word i / 64.</param>
+		/// <param name="index">Bit to start from.</param>
+		/// <param name="end">Bit to stop at.</param>
+		/// <param name="set">True to look for a set bit, false for a clear one.</param>
+		/// <returns>The found bit, or end if there is none.</returns>
+		static S FindBit(const std::uint64_t* mask, S index, S end, bool set)
+		{
+			while (index < end)
+			{
+				const size_t word = index >> 6;
+				std::uint64_t bits = set ? mask[word] : ~mask[word];
+				bits &= ~std::uint64_t(0) << (index & 63);
+
+				if (bits)
+				{
+					return std::min(static_cast<S>(word * 64 + std::countr_zero(bits)), end);
+				}
+
+				index = static_cast<S>((word + 1) * 64);
+			}
+
+			return end;
+		}
+
+		/// <summary>
+		/// Find the last bit in [begin, index] of a mask that is set, or clear, a whole word at a time.
+		/// </summary>
+		/// <param name="mask">The mask, bit i is bit i % 64 of word i / 64.</param>
+		/// <param name="index">Bit to start from, going down.</param>
+		/// <param name="begin">Lowest bit to look at.</param>
+		/// <param name="set">True to look for a set bit, false for a clear one.</param>
+		/// <returns>The found bit, or begin - 1 if there is none.</returns>
+		static S FindLastBit(const std::uint64_t* mask, S index, S begin, bool set)
+		{
+			while (index >= begin)
+			{
+				const size_t word = index >> 6;
+				std::uint64_t bits = set ? mask[word] : ~mask[word];
+				bits &= ~std::uint64_t(0) >> (63 - (index & 63));
+
+				if (bits)
+				{
+					return std::max(static_cast<S>(word * 64 + 63 - std::countl_zero(bits)), begin - 1);
+				}
+
+				index = static_cast<S>(word * 64) - 1;
+			}
+
+			return begin - 1;
+		}
+
+		/// <summary>
+		/// Find the first cell in [index, end) whose activity matches, a whole mask word at a time.
+		/// </summary>
+		/// <param name="index">Data index to start from.</param>
+		/// <param name="end">Data index to stop at.</param>
+		/// <param name="active">True to look for an active cell, false for an inactive one.</param>
+		/// <returns>The found data index, or end if there is none.</returns>
+		S FindActivity(S index, S end, bool active) const
+		{
+			return FindBit(activeMask.data(), index, end, active);
+		}
+
+		/// <summary>
+		/// Bit of a cell in lineActiveMask, on its line along a direction.
+		/// Following cells of the line are the bits after it.
+		/// </summary>
+		/// <param name="dRow">Row step of the direction, 0 or 1.</param>
+		/// <param name="dCol">Column step of the direction, -1, 0 or 1.</param>
+		S ActiveBitAlong(S row, S column, S dRow, S dCol) const
+		{
+			const S cellCount = rowCount * columnCount;
+
+			if (dRow == 0)
+				return Index(row, column);
+
+			if (dCol == 0)
+				return cellCount + column * rowCount + row;
+
+			const S diagonal = dCol > 0 ? column - row + rowCount - 1 : rowCount + columnCount - 1 + row + column;
+			return 2 * cellCount + diagonalRowOffsets[diagonal] + row;
+		}
+
+		/// <summary>
+		/// Make a cell active or inactive in activeMask, and along its lines in lineActiveMask.
+		/// </summary>
+		void WriteActiveBit(S index, bool active)
+		{
+			auto write = [active](std::pmr::vector<std::uint64_t>& mask, S bit)
+			{
+				if (active)
+					mask[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+				else
+					mask[bit >> 6] &= ~(std::uint64_t(1) << (bit & 63));
+			};
+
+			write(activeMask, index);
+
+			if constexpr (Topology::isSquare)
+			{
+				const S row = index / columnCount;
+				const S column = index % columnCount;
+				write(lineActiveMask, index);
+				write(lineActiveMask, ActiveBitAlong(row, column, 1, 0));
+				write(lineActiveMask, ActiveBitAlong(row, column, 1, 1));
+				write(lineActiveMask, ActiveBitAlong(row, column, 1, -1));
+			}
+		}
+
+		/// <summary>
+		/// Lay out the diagonals for the current size and make every cell of lineActiveMask active.
+		/// </summary>
+		void LayOutLineActiveMask()
+		{
+			lineActiveMask.clear();
+			diagonalRowOffsets.clear();
+
+			const S cellCount = static_cast<S>(data.size());
+			if (!Topology::isSquare || cellCount == 0)
+				return;
+
+			const S diagonalCount = rowCount + columnCount - 1;
+			diagonalRowOffsets.resize(2 * static_cast<size_t>(diagonalCount));
+
+			S offset = 0;
+			for (S diagonal = 0; diagonal < diagonalCount; ++diagonal)
+			{
+				// Top-Left to Bottom-Right, from (firstRow, firstRow + diagonal - rowCount + 1)
+				const S firstRow = std::max<S>(0, rowCount - 1 - diagonal);
+				diagonalRowOffsets[diagonal] = offset - firstRow;
+				offset += std::min(rowCount - firstRow, columnCount - (firstRow + diagonal - rowCount + 1));
+			}
+			for (S diagonal = 0; diagonal < diagonalCount; ++diagonal)
+			{
+				// Top-Right to Bottom-Left, from (firstRow, diagonal - firstRow)
+				const S firstRow = std::max<S>(0, diagonal - columnCount + 1);
+				diagonalRowOffsets[diagonalCount + diagonal] = offset - firstRow;
+				offset += std::min(rowCount - firstRow, diagonal - firstRow + 1);
+			}
+
+			// Rows, columns and both diagonals hold every cell once. Bits past the last one stay clear
+			const size_t bitCount = 4 * static_cast<size_t>(cellCount);
+			lineActiveMask.assign((bitCount + 63) / 64, ~std::uint64_t(0));
+			if (bitCount % 64)
+				lineActiveMask.back() = (std::uint64_t(1) << (bitCount % 64)) - 1;
+		}
+
+		/// <summary>
+		/// Find the first active cell in [index, end).
+		/// </summary>
+		/// <returns>The found data index, or end if there is none.</returns>
+		S NextActiveIndex(S index, S end) const
+		{
+			return FindActivity(index, end, true);
+		}
+
+		/// <summary>
+		/// Find the first inactive cell in [index, end).
+		/// </summary>
+		/// <returns>The found data index, or end if there is none.</returns>
+		S NextInactiveIndex(S index, S end) const
+		{
+			return FindActivity(index, end, false);
+		}
+
+		/// <summary>
+		/// Get the values of the active cells, in data order.
+		/// </summary>
+		/// <returns>The values of the active cells.</returns>
+		std::pmr::vector<T> GetActiveValues() const
+		{
+			const S cellCount = static_cast<S>(data.size());
+			std::pmr::vector<T> values(scratchResource);
+			values.reserve(GetActiveCount());
+
+			for (S begin = NextActiveIndex(0, cellCount); begin < cellCount;)
+			{
+				const S end = NextInactiveIndex(begin, cellCount);
+				values.insert(values.end(), data.begin() + begin, data.begin() + end);
+				begin = NextActiveIndex(end, cellCount);
+			}
+
+			return values;
+		}
+
+		/// <summary>
+		/// Write values to the active cells, in data order.
+		/// </summary>
+		/// <param name="values">The values, one per active cell.</param>
+		void SetActiveValues(const std::pmr::vector<T>& values)
+		{
+			const S cellCount = static_cast<S>(data.size());
+			auto source = values.begin();
+
+			for (S begin = NextActiveIndex(0, cellCount); begin < cellCount;)
+			{
+				const S end = NextInactiveIndex(begin, cellCount);
+				source = std::copy_n(source, end - begin, data.begin() + begin);
+				begin = NextActiveIndex(end, cellCount);
+			}
+
+			MarkAllChanged();
+		}
+
+		/// <summary>
+		/// Count the run of equal miskets through a cell along one line,
+		/// as if the cell held the given value.
+		/// </summary>
+		/// <param name="row">Row of the cell.</param>
+		/// <param name="column">Column of the cell.</param>
+		/// <param name="value">The value the cell is assumed to hold.</param>
+		/// <param name="dRow">Row step of the line.</param>
+		/// <param name="dCol">Column step of the line.</param>
+		/// <param name="get">Returns the misket at a cell, or nullptr if the cell should not count.</param>
+		/// <returns>Length of the run, including the cell itself.</returns>
+		template <typename Getter>
+		S RunLengthThrough(S row, S column, const T& value, S dRow, S dCol, Getter&& get) const
+		{
+			S length = 1;
+
+			for (S r = row + dRow, c = column + dCol; CheckBounds(r, c); r += dRow, c += dCol)
+			{
+				const T* other = get(r, c);
+				if (!other || !SameKey(*other, value))
+					break;
+				++length;
+			}
+
+			for (S r = row - dRow, c = column - dCol; CheckBounds(r, c); r -= dRow, c -= dCol)
+			{
+				const T* other = get(r, c);
+				if (!other || !SameKey(*other, value))
+					break;
+				++length;
+			}
+
+			return length;
+		}
+
+		/// <summary>
+		/// Count the run of equal miskets through a cell along an axis of the topology, from its neighbour tables,
+		/// as if the cell held the given value.
+		/// </summary>
+		/// <param name="index">Index of the cell.</param>
+		/// <param name="value">The value the cell is assumed to hold.</param>
+		/// <param name="axis">Axis of the line.</param>
+		/// <param name="get">Returns the misket at a cell, or nullptr if the cell should not count.</param>
+		/// <returns>Length of the run, including the cell itself. At most the length of a cycle.</returns>
+		template <typename Getter>
+		S RunLengthAlong(S index, const T& value, int axis, Getter&& get) const
+		{
+			auto continues = [&](S cell)
+			{
+				const T* other = get(cell / columnCount, cell % columnCount);
+				return other && SameKey(*other, value);
+			};
+
+			S length = 1;
+			S cell = topology.next[index * axisCount + axis];
+			for (; cell >= 0 && cell != index && continues(cell); cell = topology.next[cell * axisCount + axis])
+			{
+				++length;
+			}
+
+			// The run went round the whole cycle
+			if (cell == index)
+				return length;
+
+			for (cell = topology.previous[index * axisCount + axis]; cell >= 0 && cell != index && continues(cell); cell = topology.previous[cell * axisCount + axis])
+			{
+				++length;
+			}
+
+			return length;
+		}
+
+		/// <summary>
+		/// Would the given value complete a match at the given cell?
+		/// </summary>
+		/// <param name="row">Row of the cell.</param>
+		/// <param name="column">Column of the cell.</param>
+		/// <param name="value">The value the cell is assumed to hold.</param>
+		/// <param name="minMatchLength">Minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <param name="get">Returns the misket at a cell, or nullptr if the cell should not count.</param>
+		/// <returns>True if a match would go through the cell.</returns>
+		template <typename Getter>
+		bool FormsMatchAt(S row, S column, const T& value, unsigned int minMatchLength, MatchDirections matchDirections, Getter&& get) const
+		{
+			if constexpr (!Topology::isSquare)
+			{
+				for (int axis = 0; axis < axisCount; ++axis)
+				{
+					if (IsAxisEnabled(axis, matchDirections) && static_cast<unsigned int>(RunLengthAlong(Index(row, column), value, axis, get)) >= minMatchLength)
+						return true;
+				}
+				return false;
+			}
+
+			auto longEnough = [&](S dRow, S dCol)
+			{
+				return static_cast<unsigned int>(RunLengthThrough(row, column, value, dRow, dCol, get)) >= minMatchLength;
+			};
+
+			return (matchDirections.horizontal && longEnough(0, 1)) ||
+				(matchDirections.vertical && longEnough(1, 0)) ||
+				(matchDirections.diagonal && (longEnough(1, 1) || longEnough(1, -1)));
+		}
+
+		/// <summary>
+		/// Build a board with no matches and one planted valid move, then replace the table data with it.
+		/// </summary>
+		/// <param name="pool">The miskets to build the board from.</param>
+		/// <param name="isPalette">
+		/// If true, the pool is a palette and values can be used any number of times.
+		/// If false, every misket in the pool is used exactly once.
+		/// </param>
+		/// <param name="minMatchLength">Minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>True if the board was built, false if it is not possible with this pool.</returns>
+		bool BuildSolvableBoard(std::pmr::vector<T> pool, bool isPalette, unsigned int minMatchLength, MatchDirections matchDirections)
+		{
+			const S matchLength = static_cast<S>(minMatchLength);
+
+			if (pool.empty() || matchLength < 2)
+				return false;
+
+			// Choose the value of the planted move.
+			// It has to appear at least matchLength times.
+			std::pmr::vector<T> moveCandidates(scratchResource);
+			if (isPalette)
+			{
+				moveCandidates = pool;
+			}
+			else
+			{
+				std::pmr::vector<std::pair<T, S>> counts(scratchResource);
+				for (const auto& value : pool)
+				{
+					auto it = std::find_if(counts.begin(), counts.end(), [&](const auto& entry) { return SameKey(entry.first, value); });
+					if (it == counts.end())
+						counts.emplace_back(value, 1);
+					else
+						++it->second;
+				}
+
+				for (const auto& [value, count] : counts)
+				{
+					if (count >= matchLength)
+						moveCandidates.push_back(value);
+				}
+			}
+
+			if (moveCandidates.empty())
+				return false;
+
+			auto randomIndex = [](size_t size)
+			{
+				std::uniform_int_distribution<size_t> dis(0, size - 1);
+				return dis(randomGen);
+			};
+
+			const T moveValue = moveCandidates[randomIndex(moveCandidates.size())];
+
+			// Cells of the planted move, the last one is swapped with the cell that completes the line
+			std::pmr::vector<S> plantCells(scratchResource);
+			if constexpr (Topology::isSquare)
+			{
+				// A move is (matchLength - 1) miskets on a line, plus one misket
+				// next to the cell that completes the line. Swapping the two completes the match.
+				// Lines and offsets are steps of the axes, so diagonal lines and diagonal swaps are planted too.
+				struct MovePattern
+				{
+					MisketPosition line;
+					MisketPosition offset;
+				};
+
+				std::vector<MovePattern> patterns;
+				for (int lineAxis = 0; lineAxis < axisCount; ++lineAxis)
+				{
+					if (!IsAxisEnabled(lineAxis, matchDirections))
+						continue;
+
+					const MisketPosition line(SquareTopology::steps[lineAxis][0], SquareTopology::steps[lineAxis][1]);
+					for (int offsetAxis = 0; offsetAxis < axisCount; ++offsetAxis)
+					{
+						if (!IsAxisEnabled(offsetAxis, matchDirections))
+							continue;
+
+						const MisketPosition offset(SquareTopology::steps[offsetAxis][0], SquareTopology::steps[offsetAxis][1]);
+
+						// Bounding box of the line and the cell the partner is swapped in from
+						const S lineColumns = (matchLength - 1) * line.column;
+						const S rowsNeeded = (matchLength - 1) * line.row + offset.row + 1;
+						const S columnsNeeded = std::max<S>({ 0, lineColumns, lineColumns + offset.column }) - std::min<S>({ 0, lineColumns, lineColumns + offset.column }) + 1;
+
+						if (rowsNeeded <= rowCount && columnsNeeded <= columnCount)
+							patterns.push_back({ line, offset });
+					}
+				}
+
+				if (patterns.empty())
+					return false;
+
+				// Cell i of a planted move. The last one sits next to the cell that completes the line.
+				auto patternCell = [&](const MovePattern& pattern, S startRow, S startCol, S i)
+				{
+					MisketPosition pos(startRow + i * pattern.line.row, startCol + i * pattern.line.column);
+					if (i == matchLength - 1)
+					{
+						pos.row += pattern.offset.row;
+						pos.column += pattern.offset.column;
+					}
+					return pos;
+				};
+
+				// Find a spot where every cell of the move (and the cell that completes it) is active.
+				// Start from a random pattern and position, and take the first spot that fits.
+				std::shuffle(patterns.begin(), patterns.end(), randomGen);
+
+				MovePattern pattern {};
+				S startRow = -1;
+				S startCol = -1;
+
+				const S cellCount = static_cast<S>(data.size());
+				const S firstStart = static_cast<S>(randomIndex(data.size()));
+
+				for (size_t p = 0; p < patterns.size() && startRow < 0; ++p)
+				{
+					for (S n = 0; n < cellCount; ++n)
+					{
+						const S start = (firstStart + n) % cellCount;
+						const S r = start / columnCount;
+						const S c = start % columnCount;
+
+						bool fitsHere = IsActive(r + (matchLength - 1) * patterns[p].line.row, c + (matchLength - 1) * patterns[p].line.column);
+						for (S i = 0; i < matchLength && fitsHere; ++i)
+						{
+							fitsHere = IsActive(patternCell(patterns[p], r, c, i));
+						}
+
+						// The partner must not line up with the rest of the move before the swap, e.g. a diagonal pair of a short match
+						if (fitsHere)
+						{
+							auto getPlanted = [&](S pr, S pc) -> const T*
+							{
+								for (S i = 0; i < matchLength - 1; ++i)
+								{
+									if (patternCell(patterns[p], r, c, i) == MisketPosition(pr, pc))
+										return &moveValue;
+								}
+								return nullptr;
+							};
+
+							const MisketPosition partner = patternCell(patterns[p], r, c, matchLength - 1);
+							fitsHere = !FormsMatchAt(partner.row, partner.column, moveValue, minMatchLength, matchDirections, getPlanted);
+						}
+
+						if (fitsHere)
+						{
+							pattern = patterns[p];
+							startRow = r;
+							startCol = c;
+							break;
+						}
+					}
+				}
+
+				if (startRow < 0)
+					return false;
+
+				for (S i = 0; i < matchLength; ++i)
+				{
+					plantCells.push_back(Index(patternCell(pattern, startRow, startCol, i)));
+				}
+			}
+			else
+			{
+				// Every window of matchLength active cells on a line, with a neighbour of its last cell to swap in from off the window
+				std::pmr::vector<std::pair<S, S>> moves(scratchResource);
+				for (const TopologyLine& line : topology.lines)
+				{
+					if (!IsAxisEnabled(line.axis, matchDirections))
+						continue;
+
+					const S* cells = &topology.lineCells[line.start];
+					for (S first = 0; first + matchLength <= line.length; ++first)
+					{
+						const S* window = cells + first;
+						if (!std::all_of(window, window + matchLength, [this](S cell) { return IsActiveIndex(cell); }))
+							continue;
+
+						// On short wrapping lines the partner can already line up with the rest of the move
+						const S completing = window[matchLength - 1];
+						auto getPlanted = [&](S r, S c) -> const T*
+						{
+							return std::find(window, window + matchLength - 1, Index(r, c)) != window + matchLength - 1 ? &moveValue : nullptr;
+						};
+
+						for (int axis = 0; axis < axisCount; ++axis)
+						{
+							if (!IsAxisEnabled(axis, matchDirections))
+								continue;
+
+							for (const S partner : { topology.next[completing * axisCount + axis], topology.previous[completing * axisCount + axis] })
+							{
+								if (partner < 0 || !IsActiveIndex(partner) || std::find(window, window + matchLength, partner) != window + matchLength)
+									continue;
+
+								if (!FormsMatchAt(partner / columnCount, partner % columnCount, moveValue, minMatchLength, matchDirections, getPlanted))
+									moves.emplace_back(line.start + first, partner);
+							}
+						}
+					}
+				}
+
+				if (moves.empty())
+					return false;
+
+				const auto [window, partner] = moves[randomIndex(moves.size())];
+				plantCells.assign(&topology.lineCells[window], &topology.lineCells[window] + matchLength - 1);
+				plantCells.push_back(partner);
+			}
+
+			// Holes keep their values, they are never placed.
+			// The board is built in scratch memory and copied back, so a table on a monotonic arena doesn't grow on every reshuffle
+			std::pmr::vector<T> board(data, scratchResource);
+			std::pmr::vector<bool> placed(data.size(), false, scratchResource);
+			std::pmr::vector<bool> locked(data.size(), false, scratchResource);
+
+			auto getPlaced = [&](S r, S c) -> const T*
+			{
+				const S index = Index(r, c);
+				return placed[index] ? &board[index] : nullptr;
+			};
+
+			auto fits = [&](S index, const T& value)
+			{
+				return !FormsMatchAt(index / columnCount, index % columnCount, value, minMatchLength, matchDirections, getPlaced);
+			};
+
+			// Take a misket with the same key out of the pool, so the board keeps its own miskets
+			auto take = [&](const T& value)
+			{
+				if (isPalette)
+					return value;
+
+				// The pool is shuffled, so its order doesn't matter and the misket is swapped out with the last one
+				auto it = std::find_if(pool.begin(), pool.end(), [&](const T& other) { return SameKey(other, value); });
+				const T taken = *it;
+				*it = std::move(pool.back());
+				pool.pop_back();
+				return taken;
+			};
+
+			// Plant the move
+			for (const S index : plantCells)
+			{
+				board[index] = take(moveValue);
+				placed[index] = true;
+				locked[index] = true;
+			}
+
+			// Fill the rest without completing any match
+			for (S index = 0; index < static_cast<S>(board.size()); ++index)
+			{
+				if (placed[index] || !IsActiveIndex(index))
+					continue;
+
+				if (isPalette)
+				{
+					std::pmr::vector<T> allowed(scratchResource);
+					auto collectAllowed = [&]()
+					{
+						allowed.clear();
+						for (const auto& value : pool)
+						{
+							if (fits(index, value))
+								allowed.push_back(value);
+						}
+						return !allowed.empty();
+					};
+
+					// Nothing fits here. Recolour the nearest earlier misket that unblocks this cell.
+					for (S other = index; !collectAllowed() && other-- > 0;)
+					{
+						if (locked[other] || !placed[other])
+							continue;
+
+						const T previous = board[other];
+						for (const auto& value : pool)
+						{
+							if (SameKey(value, previous) || !fits(other, value))
+								continue;
+
+							board[other] = value;
+							if (collectAllowed())
+								break;
+						}
+
+						if (allowed.empty())
+							board[other] = previous;
+					}
+
+					if (allowed.empty())
+						return false;
+
+					board[index] = allowed[randomIndex(allowed.size())];
+					placed[index] = true;
+					continue;
+				}
+
+				// The pool is already shuffled, so the first fitting misket is a random one
+				auto it = std::find_if(pool.begin(), pool.end(), [&](const T& value) { return fits(index, value); });
+				if (it != pool.end())
+				{
+					board[index] = *it;
+					placed[index] = true;
+					*it = std::move(pool.back());
+					pool.pop_back();
+					continue;
+				}
+
+				// Nothing left fits here. Move an earlier misket here and put a leftover in its place.
+				const T leftover = pool.back();
+				bool repaired = false;
+
+				for (S other = 0; other < index && !repaired; ++other)
+				{
+					if (locked[other] || !placed[other] || !fits(index, board[other]))
+						continue;
+
+					const T moved = board[other];
+					board[index] = moved;
+					placed[index] = true;
+					placed[other] = false;
+
+					if (fits(other, leftover))
+					{
+						board[other] = leftover;
+						placed[other] = true;
+						pool.pop_back();
+						repaired = true;
+					}
+					else
+					{
+						placed[index] = false;
+						placed[other] = true;
+					}
+				}
+
+				if (!repaired)
+					return false;
+			}
+
+			std::copy(board.begin(), board.end(), data.begin());
+			MarkAllChanged();
+			std::fill(specials.begin(), specials.end(), SpecialMisket::None);
+			std::fill(payloads.begin(), payloads.end(), Payload());
+			return true;
+		}
+	};
+
+	/// <summary>
+	/// A compact copy of a table, for keeping many boards in memory (e.g. many sessions or a search tree).
+	/// Every misket is stored as a code of a few bits, packed into 64 bit words.
+	/// </summary>
+	/// <remarks>
+	/// <para>
+	/// The code of a misket is its index in the list of values given to the constructor,
+	/// so a misket type with 8 values fits in 3 bits, and one with 16 values in 4 bits.
+	/// Special miskets take 3 more bits and the activity 1 bit, per cell.
+	/// Holes don't keep their values, they read as the first value.
+	/// </para>
+	/// <para>
+	/// Cells are read and written with Get and Set, or through the proxy returned by operator().
+	/// FindMatchGroups works on the packed words, comparing a whole word of cells with its neighbours at once.
+	/// </para>
+	/// </remarks>
+	/// <typeparam name="T">The type of the miskets.</typeparam>
+	/// <typeparam name="Bits">Bits per misket code.</typeparam>
+	/// <typeparam name="S">The scalar type for the vectors (positions etc.)</typeparam>
+	template <typename T, unsigned int Bits, typename S = Scalar>
+	class FRANTICMATCH_API PackedTable
+	{
+		static_assert(Bits >= 1 && Bits <= 8, "Misket codes must be 1 to 8 bits");
+
+	public:
+		using MatchDirections = typename Table<T, S>::MatchDirections;
+
+		/// <summary>
+		/// Proxy for a misket of the table, returned by operator().
+		/// </summary>
+		class Reference
+		{
+		public:
+			operator T() const
+			{
+				return table->Get(row, column);
+			}
+
+			/// <summary>
+			/// Set the misket. A value without a code leaves it unchanged.
+			/// </summary>
+			Reference& operator=(const T& value)
+			{
+				table->Set(row, column, value);
+				return *this;
+			}
+
+			Reference& operator=(const Reference& other)
+			{
+				return *this = static_cast<T>(other);
+			}
+
+		private:
+			friend PackedTable;
+
+			Reference(PackedTable* table, S row, S column)
+				: table(table), row(row), column(column)
+			{
+			}
+
+			PackedTable* table;
+			S row;
+			S column;
+		};
+
+	private:
+		/// <summary>
+		/// A field of B bits for every cell, row by row.
+		/// Every row starts at a new word and fields never cross words, so the kernels read rows word by word in place.
+		/// Fields past the end of a row, and the top bits of a word, are unused and stay zero.
+		/// </summary>
+		template <unsigned int B>
+		struct Plane
+		{
+			static constexpr S cellsPerWord = 64 / B;
+			static constexpr unsigned int usedBits = cellsPerWord * B;
+			static constexpr std::uint64_t usedMask = usedBits == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << usedBits) - 1;
+			static constexpr std::uint64_t fieldMask = (std::uint64_t(1) << B) - 1;
+
+			std::pmr::vector<std::uint64_t> words;
+
+			/// <summary>
+			/// Words of every row.
+			/// </summary>
+			S rowWords = 0;
+
+			explicit Plane(std::pmr::memory_resource* resource)
+				: words(resource)
+			{
+			}
+
+			void Resize(S rows, S columns)
+			{
+				rowWords = RowWords(columns);
+				words.assign(static_cast<size_t>(rows) * rowWords, 0);
+			}
+
+			std::uint64_t Get(S row, S column) const
+			{
+				return (words[static_cast<size_t>(row) * rowWords + column / cellsPerWord] >> (column % cellsPerWord * B)) & fieldMask;
+			}
+
+			void Set(S row, S column, std::uint64_t code)
+			{
+				std::uint64_t& word = words[static_cast<size_t>(row) * rowWords + column / cellsPerWord];
+				const unsigned int shift = column % cellsPerWord * B;
+				word = (word & ~(fieldMask << shift)) | ((code & fieldMask) << shift);
+			}
+
+			/// <summary>
+			/// First word of a row.
+			/// </summary>
+			const std::uint64_t* Row(S row) const
+			{
+				return words.data() + static_cast<size_t>(row) * rowWords;
+			}
+
+			/// <summary>
+			/// Number of words of a row.
+			/// </summary>
+			static S RowWords(S columns)
+			{
+				return (columns + cellsPerWord - 1) / cellsPerWord;
+			}
+		};
+
+		S rowCount = 0;
+		S columnCount = 0;
+		int minimumMatchLength;
+
+		/// <summary>
+		/// Misket of every code.
+		/// </summary>
+		std::pmr::vector<T> values;
+
+		Plane<Bits> codes;
+		Plane<3> specials;
+
+		/// <summary>
+		/// One bit per cell, like Table's active mask.
+		/// </summary>
+		Plane<1> activeMask;
+
+	public:
+		/// <param name="rows">Number of rows.</param>
+		/// <param name="columns">Number of columns.</param>
+		/// <param name="values">Every value the miskets can have, in code order. Up to 2^Bits values, not empty.</param>
+		/// <param name="minMatchLength">Minimum length of a match.</param>
+		/// <param name="resource">Memory for the board and the returned match groups.</param>
+		PackedTable(S rows, S columns, std::span<const T> values, int minMatchLength = 3u, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: minimumMatchLength(minMatchLength), values(values.begin(), values.begin() + std::min<size_t>(values.size(), size_t(1) << Bits), resource), codes(resource), specials(resource), activeMask(resource)
+		{
+			Resize(rows, columns);
+		}
+
+		Reference operator()(S row, S column)
+		{
+			return Reference(this, row, column);
+		}
+
+		Reference operator()(MisketPosition pos)
+		{
+			return Reference(this, pos.row, pos.column);
+		}
+
+		T operator()(S row, S column) const
+		{
+			return Get(row, column);
+		}
+
+		T operator()(MisketPosition pos) const
+		{
+			return Get(pos.row, pos.column);
+		}
+
+		/// <summary>
+		/// Get a misket from the table.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <returns>The misket at the specified row and column.</returns>
+		T Get(S row, S column) const
+		{
+			return values[codes.Get(row, column)];
+		}
+
+		/// <summary>
+		/// Get a misket from the table.
+		/// </summary>
+		/// <param name="pos">The position of the misket.</param>
+		/// <returns>The misket at the specified position.</returns>
+		T Get(MisketPosition pos) const
+		{
+			return Get(pos.row, pos.column);
+		}
+
+		/// <summary>
+		/// Set a misket in the table.
+		/// </summary>
+		/// <param name="row">The row index.</param>
+		/// <param name="column">The column index.</param>
+		/// <param name="value">The new misket value to set.</param>
+		/// <returns>False if the value has no code. The misket is left unchanged.</returns>
+		bool Set(S row, S column, const T& value)
+		{
+			const auto it = std::find(values.begin(), values.end(), value);
+			if (it == values.end())
+				return false;
+
+			codes.Set(row, column, static_cast<std::uint64_t>(it - values.begin()));
+			return true;
+		}
+
+		/// <summary>
+		/// Set a misket in the table.
+		/// </summary>
+		/// <param name="pos">The position of the misket.</param>
+		/// <param name="value">The new misket value to set.</param>
+		/// <returns>False if the value has no code. The misket is left unchanged.</returns>
+		bool Set(MisketPosition pos, const T& value)
+		{
+			return Set(pos.row, pos.column, value);
+		}
+
+		SpecialMisket GetSpecial(S row, S column) const
+		{
+			return static_cast<SpecialMisket>(specials.Get(row, column));
+		}
+
+		void SetSpecial(S row, S column, SpecialMisket special)
+		{
+			specials.Set(row, column, static_cast<std::uint64_t>(special));
+		}
+
+		bool IsActive(S row, S column) const
+		{
+			return activeMask.Get(row, column);
+		}
+
+		void SetActive(S row, S column, bool active)
+		{
+			activeMask.Set(row, column, active);
+		}
+
+		S GetRowCount() const
+		{
+			return rowCount;
+		}
+
+		S GetColumnCount() const
+		{
+			return columnCount;
+		}
+
+		/// <summary>
+		/// Get the values of the codes.
+		/// </summary>
+		std::span<const T> GetValues() const
+		{
+			return values;
+		}
+
+		/// <summary>
+		/// Get the size of the packed board in bytes.
+		/// </summary>
+		size_t GetByteSize() const
+		{
+			return (codes.words.size() + specials.words.size() + activeMask.words.size()) * sizeof(std::uint64_t);
+		}
+
+		/// <summary>
+		/// Resize the table. Every cell becomes an active cell with the first value.
+		/// </summary>
+		/// <param name="newRows">Target number of rows.</param>
+		/// <param name="newColumns">Target number of columns.</param>
+		void Resize(S newRows, S newColumns)
+		{
+			rowCount = newRows;
+			columnCount = newColumns;
+
+			codes.Resize(newRows, newColumns);
+			specials.Resize(newRows, newColumns);
+			activeMask.Resize(newRows, newColumns);
+
+			// Cells past the end of a row stay inactive
+			const S maskWords = activeMask.rowWords;
+			for (S row = 0; row < newRows; ++row)
+			{
+				std::fill_n(activeMask.words.begin() + static_cast<size_t>(row) * maskWords, maskWords, ~std::uint64_t(0));
+				if (newColumns % 64)
+					activeMask.words[static_cast<size_t>(row + 1) * maskWords - 1] = (std::uint64_t(1) << (newColumns % 64)) - 1;
+			}
+		}
+
+		/// <summary>
+		/// Copy the miskets, special miskets and holes of a table, resizing to it.
+		/// </summary>
+		/// <param name="table">The table to copy.</param>
+		/// <returns>False if an active cell has a value without a code. The packed table is left partly copied.</returns>
+		bool Pack(const Table<T, S>& table)
+		{
+			if (table.GetRowCount() != rowCount || table.GetColumnCount() != columnCount)
+			{
+				Resize(table.GetRowCount(), table.GetColumnCount());
+			}
+
+			for (S row = 0; row < rowCount; ++row)
+			{
+				for (S column = 0; column < columnCount; ++column)
+				{
+					const bool isActive = table.IsActive(row, column);
+					SetActive(row, column, isActive);
+					SetSpecial(row, column, table.GetSpecial(row, column));
+
+					if (!isActive)
+						codes.Set(row, column, 0);
+					else if (!Set(row, column, table.Get(row, column)))
+						return false;
+				}
+			}
+
+			return true;
+		}
+
+		/// <summary>
+		/// Copy the miskets, special miskets and holes to a table, resizing it.
+		/// </summary>
+		/// <param name="table">The table to write to.</param>
+		void Unpack(Table<T, S>& table) const
+		{
+			if (table.GetRowCount() != rowCount || table.GetColumnCount() != columnCount)
+			{
+				table.Resize(rowCount, columnCount);
+			}
+
+			for (S row = 0; row < rowCount; ++row)
+			{
+				for (S column = 0; column < columnCount; ++column)
+				{
+					table.Set(row, column, Get(row, column));
+					table.SetSpecial(row, column, GetSpecial(row, column));
+					table.SetActive(row, column, IsActive(row, column));
+				}
+			}
+		}
+
+		/// <summary>
+		/// Find matches in the table and return as groups of matches.
+		/// Same groups, in the same order, as Table::FindMatchGroups on the unpacked table.
+		/// </summary>
+		/// <remarks>
+		/// Every row of the codes and the active mask starts at a new word, so rows line up word by word.
+		/// Every pair of neighbours is compared a word at a time: a word of codes is xored with the neighbouring row's word,
+		/// shifted by a cell for diagonals, and the cells whose fields came out zero are equal.
+		/// Runs of equal pairs long enough for a match are found with shifts and ands on the cell masks,
+		/// and only the lines holding one are walked to collect the groups.
+		/// </remarks>
+		/// <param name="minMatchLength">Override for minimum length of a match.</param>
+		/// <param name="matchDirections">Match directions to check.</param>
+		/// <returns>A vector of match groups.</returns>
+		MisketMatchGroups FindMatchGroups(unsigned int minMatchLength = TABLE_MATCH_LENGTH, MatchDirections matchDirections = MatchDirections()) const
+		{
+			if (minMatchLength == TABLE_MATCH_LENGTH)
+			{
+				minMatchLength = minimumMatchLength;
+			}
+
+			std::pmr::memory_resource* resource = values.get_allocator().resource();
+			MisketMatchGroups matchGroups(resource);
+			if (rowCount == 0 || columnCount == 0)
+				return matchGroups;
+
+			const S diagonalCount = rowCount + columnCount - 1;
+			// Lines holding a match: rows, columns, then both kinds of diagonal
+			std::pmr::vector<std::uint8_t> hits(rowCount + columnCount + 2 * static_cast<size_t>(diagonalCount), minMatchLength <= 1, resource);
+			std::uint8_t* rowHits = hits.data();
+			std::uint8_t* columnHits = rowHits + rowCount;
+			std::uint8_t* downRightHits = columnHits + columnCount;
+			std::uint8_t* downLeftHits = downRightHits + diagonalCount;
+
+			if (minMatchLength > 1)
+			{
+				FindHitLines(minMatchLength, matchDirections, rowHits, columnHits, downRightHits, downLeftHits);
+			}
+
+			auto walkLine = [&](S startRow, S startColumn, S dRow, S dCol)
+			{
+				S runStart = 0;
+				S runLength = 0;
+				std::uint64_t runCode = 0;
+
+				auto flushRun = [&]()
+				{
+					if (runLength > 0 && static_cast<unsigned int>(runLength) >= minMatchLength)
+					{
+						MisketMatchGroup& group = matchGroups.emplace_back();
+						group.reserve(runLength);
+						for (S k = runStart; k < runStart + runLength; ++k)
+						{
+							group.push_back(MisketPosition(startRow + k * dRow, startColumn + k * dCol));
+						}
+					}
+					runLength = 0;
+				};
+
+				S k = 0;
+				for (S row = startRow, column = startColumn; row >= 0 && row < rowCount && column >= 0 && column < columnCount; row += dRow, column += dCol, ++k)
+				{
+					if (!IsActive(row, column))
+					{
+						flushRun();
+						continue;
+					}
+
+					const std::uint64_t code = codes.Get(row, column);
+					if (runLength > 0 && code != runCode)
+						flushRun();
+
+					if (runLength == 0)
+					{
+						runStart = k;
+						runCode = code;
+					}
+					++runLength;
+				}
+
+				flushRun();
+			};
+
+			// Same line order as Table::FindMatchGroups
+			if (matchDirections.horizontal)
+			{
+				for (S row = 0; row < rowCount; ++row)
+				{
+					if (rowHits[row])
+						walkLine(row, 0, 0, 1);
+				}
+			}
+
+			if (matchDirections.vertical)
+			{
+				for (S col = 0; col < columnCount; ++col)
+				{
+					if (columnHits[col])
+						walkLine(0, col, 1, 0);
+				}
+			}
+
+			if (matchDirections.diagonal)
+			{
+				// Top-Left to Bottom-Right, numbered by column - row + rowCount - 1
+				for (S row = 0; row < rowCount; ++row)
+				{
+					if (downRightHits[rowCount - 1 - row])
+						walkLine(row, 0, 1, 1);
+				}
+				for (S col = 1; col < columnCount; ++col)
+				{
+					if (downRightHits[rowCount - 1 + col])
+						walkLine(0, col, 1, 1);
+				}
+
+				// Top-Right to Bottom-Left, numbered by row + column
+				for (S row = 0; row < rowCount; ++row)
+				{
+					if (downLeftHits[row + columnCount - 1])
+						walkLine(row, columnCount - 1, 1, -1);
+				}
+				for (S col = columnCount - 2; col >= 0; --col)
+				{
+					if (downLeftHits[col])
+						walkLine(0, col, 1, -1);
+				}
+			}
+
+			return matchGroups;
+		}
+
+	private:
+		S Index(S row, S column) const
+		{
+			return row * columnCount + column;
+		}
+
+		/// <summary>
+		/// Mark the lines holding a run of at least minMatchLength equal, active miskets.
+		/// </summary>
+		void FindHitLines(unsigned int minMatchLength, MatchDirections matchDirections, std::uint8_t* rowHits, std::uint8_t* columnHits, std::uint8_t* downRightHits, std::uint8_t* downLeftHits) const
+		{
+			std::pmr::memory_resource* resource = values.get_allocator().resource();
+			const S maskWords = activeMask.rowWords;
+
+			// A run of minMatchLength cells is pairCount equal pairs in a row
+			const S pairCount = static_cast<S>(std::min<unsigned int>(minMatchLength - 1, rowCount + columnCount));
+
+			// The cell masks of the equal pairs of the last pairCount rows, then the window of a run and a shifted mask.
+			// The planes are read in place.
+			std::pmr::vector<std::uint64_t> scratch((static_cast<size_t>(pairCount) + 2) * maskWords, resource);
+			std::uint64_t* pairs = scratch.data();
+			std::uint64_t* window = pairs + static_cast<size_t>(pairCount) * maskWords;
+			std::uint64_t* shifted = window + maskWords;
+
+			auto pairRow = [&](S row) { return pairs + static_cast<size_t>(row % pairCount) * maskWords; };
+
+			// Bit c of a row: cell (row, c) equals cell (row + dRow, c + dCol), dCol being -1, 0 or 1
+			auto comparePairs = [&](S row, S dRow, S dCol)
+			{
+				ComparePairRow(codes.Row(row), codes.Row(row + dRow), activeMask.Row(row), activeMask.Row(row + dRow), dCol, pairRow(row));
+			};
+
+			// Does a line hold pairCount set bits in a row, stepping a cell at a time?
+			if (matchDirections.horizontal)
+			{
+				for (S row = 0; row < rowCount; ++row)
+				{
+					comparePairs(row, 0, 1);
+					std::copy_n(pairRow(row), maskWords, window);
+					for (S k = 1; k < pairCount; ++k)
+					{
+						ShiftCells(pairRow(row), maskWords, k, shifted);
+						AndInto(window, shifted, maskWords);
+					}
+					rowHits[row] = std::any_of(window, window + maskWords, [](std::uint64_t word) { return word != 0; });
+				}
+			}
+
+			// Vertical and diagonal runs step a row at a time, so the masks of pairCount rows are anded,
+			// shifted a cell per row for diagonals. Bit c of the window of row r is a run starting at (r, c).
+			// The masks go round a ring of pairCount rows, each one compared when the window first reaches it.
+			auto findRunStarts = [&](S dCol, auto&& onStart)
+			{
+				for (S row = 0; row + 1 < pairCount && row + 1 < rowCount; ++row)
+				{
+					comparePairs(row, 1, dCol);
+				}
+
+				for (S row = 0; row + pairCount <= rowCount - 1; ++row)
+				{
+					comparePairs(row + pairCount - 1, 1, dCol);
+					std::copy_n(pairRow(row), maskWords, window);
+					for (S k = 1; k < pairCount; ++k)
+					{
+						ShiftCells(pairRow(row + k), maskWords, k * dCol, shifted);
+						AndInto(window, shifted, maskWords);
+					}
+
+					for (S word = 0; word < maskWords; ++word)
+					{
+						for (std::uint64_t bits = window[word]; bits; bits &= bits - 1)
+						{
+							onStart(row, word * 64 + std::countr_zero(bits));
+						}
+					}
+				}
+			};
+
+			if (matchDirections.vertical)
+			{
+				findRunStarts(0, [&](S, S column) { columnHits[column] = true; });
+			}
+
+			if (matchDirections.diagonal)
+			{
+				findRunStarts(1, [&](S row, S column) { downRightHits[column - row + rowCount - 1] = true; });
+				findRunStarts(-1, [&](S row, S column) { downLeftHits[row + column] = true; });
+			}
+		}
+
+		/// <summary>
+		/// Compare every cell of an aligned row with the cell dCol columns over in another one.
+		/// </summary>
+		/// <param name="out">Cell mask of the row, set where both cells are active and equal.</param>
+		void ComparePairRow(const std::uint64_t* codeRow, const std::uint64_t* otherCodeRow, const std::uint64_t* activeRow, const std::uint64_t* otherActiveRow, S dCol, std::uint64_t* out) const
+		{
+			using CodePlane = Plane<Bits>;
+			constexpr S cellsPerWord = CodePlane::cellsPerWord;
+			constexpr unsigned int usedBits = CodePlane::usedBits;
+
+			// Lowest bit of every field
+			constexpr std::uint64_t fieldLows = []()
+			{
+				std::uint64_t lows = 0;
+				for (S cell = 0; cell < cellsPerWord; ++cell)
+				{
+					lows |= std::uint64_t(1) << (cell * Bits);
+				}
+				return lows;
+			}();
+
+			const S codeWords = CodePlane::RowWords(columnCount);
+			const S maskWords = Plane<1>::RowWords(columnCount);
+
+			std::fill_n(out, maskWords, 0);
+
+			for (S word = 0; word < codeWords; ++word)
+			{
+				// The other row's word, moved so that its cells line up with ours
+				std::uint64_t other = otherCodeRow[word];
+				if (dCol > 0)
+				{
+					other = (other >> Bits) | (word + 1 < codeWords ? otherCodeRow[word + 1] << (usedBits - Bits) : 0);
+				}
+				else if (dCol < 0)
+				{
+					other = (other << Bits) | (word > 0 ? otherCodeRow[word - 1] >> (usedBits - Bits) : 0);
+				}
+
+				// A field is zero where the codes are equal
+				const std::uint64_t difference = (codeRow[word] ^ other) & CodePlane::usedMask;
+				std::uint64_t fieldBits = difference;
+				for (unsigned int bit = 1; bit < Bits; ++bit)
+				{
+					fieldBits |= difference >> bit;
+				}
+
+				for (std::uint64_t equal = ~fieldBits & fieldLows; equal; equal &= equal - 1)
+				{
+					const S cell = word * cellsPerWord + std::countr_zero(equal) / Bits;
+					if (cell >= columnCount)
+						break;
+
+					out[cell >> 6] |= std::uint64_t(1) << (cell & 63);
+				}
+			}
+
+			// Both cells must be active. Cells past the edges are inactive, which also drops the pairs leaving the board.
+			for (S word = 0; word < maskWords; ++word)
+			{
+				std::uint64_t otherActive = otherActiveRow[word];
+				if (dCol > 0)
+					otherActive = (otherActive >> 1) | (word + 1 < maskWords ? otherActiveRow[word + 1] << 63 : 0);
+				else if (dCol < 0)
+					otherActive = (otherActive << 1) | (word > 0 ? otherActiveRow[word - 1] >> 63 : 0);
+
+				out[word] &= activeRow[word] & otherActive;
+			}
 		}
 
 		/// <summary>
-		/// Randomise the table using a range of possible values.
+		/// Move the bits of a cell mask down by count cells, so bit c gets cell c + count. Negative counts move them up.
 		/// </summary>
-		/// <param name="checkMatches">Should we check for matches and re-randomise matching elements?</param>
-		void Randomise(bool checkMatches = true)
+		static void ShiftCells(const std::uint64_t* in, S wordCount, S count, std::uint64_t* out)
 		{
-			std::uniform_int_distribution<S> dis(0, possibleValues.size() - 1);
+			const bool down = count >= 0;
+			const S cells = down ? count : -count;
+			const S wordShift = cells / 64;
+			const unsigned int bitShift = cells % 64;
+
+			for (S word = 0; word < wordCount; ++word)
+			{
+				const S from = down ? word + wordShift : word - wordShift;
+				const S next = down ? from + 1 : from - 1;
+				const std::uint64_t low = (from >= 0 && from < wordCount) ? in[from] : 0;
+				const std::uint64_t high = (bitShift && next >= 0 && next < wordCount) ? in[next] : 0;
+
+				if (down)
+					out[word] = (low >> bitShift) | (bitShift ? high << (64 - bitShift) : 0);
+				else
+					out[word] = (low << bitShift) | (bitShift ? high >> (64 - bitShift) : 0);
+			}
+		}
+
+		static void AndInto(std::uint64_t* target, const std::uint64_t* mask, S wordCount)
+		{
+			for (S word = 0; word < wordCount; ++word)
+			{
+				target[word] &= mask[word];
+			}
+		}
+	};
+
+	/// <summary>
+	/// Publishes read-only copies of a board from one writer thread to any number of reader threads.
+	/// </summary>
+	/// <remarks>
+	/// <para>
+	/// Copies live in a fixed set of slots. Publish copies the board into a slot no reader holds,
+	/// then makes it the latest with one atomic store. Acquire pins the latest slot with a reader count,
+	/// and if a publish got in between, lets it go and tries again.
+	/// Neither side takes a lock, and the writer never waits: if every other slot is held, Publish skips the board and returns false.
+	/// </para>
+	/// <para>
+	/// Slots keep their memory, so a warmed up publisher copies without allocating.
+	/// With two slots more than the snapshots held at once, there is always a free slot.
+	/// </para>
+	/// <para>
+	/// Snapshots hold the cells only: miskets, special miskets and activity.
+	/// </para>
+	/// </remarks>
+	/// <typeparam name="T">The type of the miskets.</typeparam>
+	/// <typeparam name="S">The scalar type for the vectors (positions etc.)</typeparam>
+	template <typename T, typename S = Scalar>
+	class FRANTICMATCH_API SnapshotPublisher
+	{
+		struct Slot
+		{
+			/// <summary>
+			/// Snapshots holding the slot, and readers about to check it is still the latest.
+			/// </summary>
+			std::atomic<std::uint32_t> readerCount = 0;
+
+			std::uint64_t epoch = 0;
+			S rowCount = 0;
+			S columnCount = 0;
+			std::vector<T> data;
+			std::vector<SpecialMisket> specials;
+			std::vector<std::uint64_t> activeMask;
+		};
+
+	public:
+		/// <summary>
+		/// Most slots a publisher can have. The slot index shares a word with the epoch.
+		/// </summary>
+		static constexpr size_t MAX_SLOT_COUNT = 255;
+
+		/// <summary>
+		/// A published board, held until it is released or destroyed.
+		/// </summary>
+		/// <remarks>
+		/// Only read through a snapshot on one thread at a time, and release it before the publisher is destroyed.
+		/// The board doesn't change while it is held.
+		/// </remarks>
+		class Snapshot
+		{
+		public:
+			Snapshot() = default;
+
+			Snapshot(const Snapshot&) = delete;
+			Snapshot& operator=(const Snapshot&) = delete;
+
+			Snapshot(Snapshot&& other) noexcept
+				: slot(std::exchange(other.slot, nullptr))
+			{
+			}
 
-			for (S row = 0; row < GetRowCount(); ++row)
+			Snapshot& operator=(Snapshot&& other) noexcept
 			{
-				for (S col = 0; col < GetColumnCount(); ++col)
+				if (this != &other)
 				{
-					Set(row, col, possibleValues[dis(randomGen)]);
+					Release();
+					slot = std::exchange(other.slot, nullptr);
 				}
+				return *this;
 			}
 
-			if (!checkMatches)
+			~Snapshot()
 			{
-				return;
+				Release();
 			}
 
-			// Check for matches and re-randomise matching elements
-			auto matchGroups = FindMatchGroups();
+			/// <summary>
+			/// Does the snapshot hold a board? False before the first publish.
+			/// </summary>
+			bool IsValid() const
+			{
+				return slot != nullptr;
+			}
 
-			while (!matchGroups.empty())
+			/// <summary>
+			/// Let the publisher reuse the board's slot.
+			/// </summary>
+			void Release()
 			{
-				for (const auto& group : matchGroups)
+				if (slot != nullptr)
 				{
-					for (const auto& pos : group)
-					{
-						Set(pos, static_cast<T>(dis(randomGen)));
-					}
+					slot->readerCount.fetch_sub(1);
+					slot = nullptr;
 				}
-				matchGroups = FindMatchGroups();
 			}
-		}
-		
-		/*
-		// Debug
-		// Get random misket from table
-		T& GetRandomisedMisket()
+
+			/// <summary>
+			/// Number of the publish the board came from, counting from 1.
+			/// Later publishes have higher numbers.
+			/// </summary>
+			std::uint64_t GetEpoch() const
+			{
+				return slot->epoch;
+			}
+
+			S GetRowCount() const
+			{
+				return slot->rowCount;
+			}
+
+			S GetColumnCount() const
+			{
+				return slot->columnCount;
+			}
+
+			const T& Get(S row, S column) const
+			{
+				return slot->data[row * slot->columnCount + column];
+			}
+
+			const T& Get(MisketPosition pos) const
+			{
+				return Get(pos.row, pos.column);
+			}
+
+			SpecialMisket GetSpecial(S row, S column) const
+			{
+				return slot->specials[row * slot->columnCount + column];
+			}
+
+			bool IsActive(S row, S column) const
+			{
+				const S index = row * slot->columnCount + column;
+				return (slot->activeMask[index >> 6] >> (index & 63)) & 1u;
+			}
+
+			std::span<const T> GetRowSpan(S rowIndex) const
+			{
+				return { slot->data.data() + rowIndex * slot->columnCount, static_cast<size_t>(slot->columnCount) };
+			}
+
+			StridedSpan<const T> GetColumnView(S columnIndex) const
+			{
+				return { slot->data.data() + columnIndex, static_cast<size_t>(slot->rowCount), slot->columnCount };
+			}
+
+		private:
+			friend SnapshotPublisher;
+
+			explicit Snapshot(Slot* slot)
+				: slot(slot)
+			{
+			}
+
+			Slot* slot = nullptr;
+		};
+
+		/// <param name="slotCount">Number of boards kept. At least two more than the snapshots held at once, 3 for one reader.</param>
+		explicit SnapshotPublisher(size_t slotCount = 3)
+			: slotCount(std::clamp<size_t>(slotCount, 2, MAX_SLOT_COUNT)), slots(std::make_unique<Slot[]>(this->slotCount))
 		{
-			std::uniform_int_distribution<S> dis(0, data.size() - 1);
-			return data[dis(randomGen)];
 		}
-		*/
+
+		SnapshotPublisher(const SnapshotPublisher&) = delete;
+		SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
 
 		/// <summary>
-		/// Generate a random misket from the possible values.
+		/// Copy a board and make it the latest snapshot. Only call from one thread at a time.
 		/// </summary>
-		/// <returns>A generated random misket.</returns>
-		T GenerateRandomMisket()
+		/// <param name="table">The board to publish.</param>
+		/// <returns>False if every other slot is held, the latest snapshot stays as it was then.</returns>
+		template <typename Key, typename Payload, typename Topology>
+		bool Publish(const Table<T, S, Key, Payload, Topology>& table)
 		{
-			std::uniform_int_distribution<S> dis(0, possibleValues.size() - 1);
-			return possibleValues[dis(randomGen)];
+			const std::uint64_t current = latest.load();
+			for (size_t index = 0; index < slotCount; ++index)
+			{
+				// A reader that pins the slot after this check sees the newer latest and lets it go
+				Slot& slot = slots[index];
+				if ((current != 0 && index == (current & 0xFF)) || slot.readerCount.load() != 0)
+					continue;
+
+				slot.epoch = ++epoch;
+				slot.rowCount = table.GetRowCount();
+				slot.columnCount = table.GetColumnCount();
+				slot.data.assign(table.GetCells().begin(), table.GetCells().end());
+				slot.specials.assign(table.GetSpecials().begin(), table.GetSpecials().end());
+				slot.activeMask.assign(table.GetActiveMask().begin(), table.GetActiveMask().end());
+
+				latest.store((slot.epoch << 8) | index);
+				return true;
+			}
+
+			return false;
 		}
 
 		/// <summary>
-		/// Shuffles the table.
+		/// Hold the latest published board. Can be called from any thread.
 		/// </summary>
-		void Shuffle()
+		/// <returns>The snapshot, invalid if nothing was published yet.</returns>
+		Snapshot Acquire() const
 		{
-			std::shuffle(data.begin(), data.end(), randomGen);
+			for (std::uint64_t current = latest.load(); current != 0;)
+			{
+				Slot& slot = slots[current & 0xFF];
+				slot.readerCount.fetch_add(1);
+
+				// Still the latest, so the writer can't have picked the slot before the pin
+				const std::uint64_t check = latest.load();
+				if (check == current)
+					return Snapshot(&slot);
+
+				slot.readerCount.fetch_sub(1);
+				current = check;
+			}
+
+			return Snapshot();
 		}
 
 		/// <summary>
-		/// Swap two miskets in the table.
+		/// Get the epoch of the latest snapshot, 0 if nothing was published yet.
 		/// </summary>
-		/// <param name="row1">Row of the first misket.</param>
-		/// <param name="col1">Column of the first misket.</param>
-		/// <param name="row2">Row of the second misket.</param>
-		/// <param name="col2">Column of the second misket.</param>
-		void Swap(S row1, S col1, S row2, S col2)
+		std::uint64_t GetLatestEpoch() const
 		{
-			std::swap((*this)(row1, col1), (*this)(row2, col2));
+			return latest.load() >> 8;
 		}
 
+	private:
+		size_t slotCount;
+		std::unique_ptr<Slot[]> slots;
+
 		/// <summary>
-		/// Swap two miskets in the table.
+		/// Epoch and slot of the latest snapshot, as epoch * 256 + slot. 0 before the first publish.
 		/// </summary>
-		/// <param name="pos1">Position of the first misket.</param>
-		/// <param name="pos2">Position of the second misket.</param>
-		void Swap(MisketPosition pos1, MisketPosition pos2)
+		std::atomic<std::uint64_t> latest = 0;
+
+		/// <summary>
+		/// Epoch of the last publish. Only used by the writer.
+		/// </summary>
+		std::uint64_t epoch = 0;
+	};
+
+	/// <summary>
+	/// Hosts many concurrent game sessions in one process.
+	/// </summary>
+	/// <remarks>
+	/// <para>
+	/// Sessions live in fixed-size blocks that are never moved, and destroyed sessions are recycled.
+	/// Every block stores the boards of its sessions in one arena, through a pool that is safe to use from many threads,
+	/// since sessions of one block are played on different workers and their tables keep allocating (move tracking, events...).
+	/// A recycled session gets a new table built from the memory its old one gave back to the pool,
+	/// so a warmed up host creates sessions without going to the heap.
+	/// </para>
+	/// <para>
+	/// The temporaries of a move come from an arena of the worker thread, which is released after every move.
+	/// </para>
+	/// <para>
+	/// Moves are processed on a work-stealing thread pool. Moves of one session run one at a time, in order.
+	/// Moves of different sessions run in parallel.
+	/// </para>
+	/// </remarks>
+	/// <typeparam name="T">The type of the miskets.</typeparam>
+	/// <typeparam name="S">The scalar type for the vectors (positions etc.)</typeparam>
+	template <typename T, typename S = Scalar>
+	class FRANTICMATCH_API SessionHost
+	{
+	public:
+		using SessionId = std::uint32_t;
+
+		/// <summary>
+		/// Invalid session ID.
+		/// Returned when the host is full.
+		/// </summary>
+		static constexpr SessionId INVALID_SESSION = ~SessionId(0);
+
+		/// <summary>
+		/// Number of sessions allocated together.
+		/// </summary>
+		static constexpr size_t SESSION_BLOCK_SIZE = 256;
+
+		/// <summary>
+		/// Size of the per-thread arena for the temporaries of a move.
+		/// It grows from the default resource if a move needs more.
+		/// </summary>
+		static constexpr size_t SCRATCH_ARENA_SIZE = 64 * 1024;
+
+		/// <summary>
+		/// Result of a processed move.
+		/// </summary>
+		struct MoveResult
 		{
-			std::swap((*this)(pos1), (*this)(pos2));
-		}
+			/// <summary>
+			/// Did the move make a match?
+			/// </summary>
+			bool valid = false;
+
+			/// <summary>
+			/// Was the board reshuffled because it had no moves left?
+			/// </summary>
+			bool reshuffled = false;
+
+			/// <summary>
+			/// Number of miskets cleared by the move and its cascades.
+			/// </summary>
+			S clearedCount = 0;
+
+			/// <summary>
+			/// Number of cascade steps.
+			/// </summary>
+			S cascadeCount = 0;
+
+			/// <summary>
+			/// Time from submitting the move to the end of processing.
+			/// </summary>
+			std::chrono::nanoseconds latency {};
+		};
 
 		/// <summary>
-		/// Check if two positions are adjacent.
+		/// Called on a worker thread after every processed move.
+		/// The table can be read and changed here, the session is not processing anything else.
+		/// Match groups created here are released after the callback returns.
 		/// </summary>
-		/// <param name="row1">Row of the first position.</param>
-		/// <param name="col1">Column of the first position.</param>
-		/// <param name="row2">Row of the second position.</param>
-		/// <param name="col2">Column of the second position.</param>
-		/// <param name="matchDirections">Match directions to check.</param>
-		/// <returns>True if the positions are adjacent, false otherwise.</returns>
-		bool IsAdjacent(S row1, S col1, S row2, S col2, MatchDirections matchDirections = MatchDirections()) const
+		using MoveCallback = std::function<void(SessionId, Table<T, S>&, const MoveResult&)>;
+
+	private:
+		struct PendingMove
 		{
-			if (matchDirections.horizontal && row1 == row2 && std::abs(col1 - col2) == 1)
-				return true;
+			MisketPosition first;
+			MisketPosition second;
+			std::chrono::steady_clock::time_point submitTime;
+		};
 
-			if (matchDirections.vertical && col1 == col2 && std::abs(row1 - row2) == 1)
-				return true;
+		struct Session
+		{
+			/// <summary>
+			/// Built in the block's arena when the block is created.
+			/// </summary>
+			std::optional<Table<T, S>> table;
+
+			/// <summary>
+			/// Guards pending and scheduled.
+			/// </summary>
+			std::mutex mutex;
+			std::vector<PendingMove> pending;
+			std::vector<PendingMove> processing;
+
+			/// <summary>
+			/// Is a task processing this session's moves queued or running?
+			/// </summary>
+			bool scheduled = false;
+
+			bool alive = false;
+		};
+
+		struct SessionBlock
+		{
+			/// <summary>
+			/// Arena the block's boards are carved from.
+			/// </summary>
+			std::pmr::monotonic_buffer_resource storage;
+
+			/// <summary>
+			/// Board storage of every session in the block. Sessions of the block allocate from it on many workers at once.
+			/// </summary>
+			std::pmr::synchronized_pool_resource boards;
+
+			std::array<Session, SESSION_BLOCK_SIZE> sessions;
+
+			explicit SessionBlock(size_t storageSize)
+				: storage(storageSize), boards(&storage)
+			{
+			}
+		};
+
+		S rowCount;
+		S columnCount;
+		std::vector<T> possibleValues;
+		int minimumMatchLength;
+		size_t maxSessionCount;
+
+		/// <summary>
+		/// Session blocks. Sized once, so workers can read it while sessions are created.
+		/// </summary>
+		std::vector<std::unique_ptr<SessionBlock>> blocks;
+
+		/// <summary>
+		/// Guards blocks, freeIds and sessionCount.
+		/// </summary>
+		std::mutex hostMutex;
+		std::vector<SessionId> freeIds;
+		size_t sessionCount = 0;
 
-			if (matchDirections.diagonal && std::abs(row1 - row2) == 1 && std::abs(col1 - col2) == 1)
-				return true;
+		/// <summary>
+		/// Sessions ever created. IDs below it are in blocks that exist, so it is read without the lock.
+		/// </summary>
+		std::atomic<size_t> createdCount = 0;
 
-			return false;
-		}
+		MoveCallback moveCallback;
+		ThreadPool pool;
 
-		bool IsAdjacent(MisketPosition pos1, MisketPosition pos2, MatchDirections matchDirections = MatchDirections()) const
+	public:
+		/// <summary>
+		/// Create a host. Every session gets a table with the same rules.
+		/// </summary>
+		/// <param name="rows">Number of rows of every table.</param>
+		/// <param name="columns">Number of columns of every table.</param>
+		/// <param name="possibleValues">Possible values for the miskets.</param>
+		/// <param name="minMatchLength">Minimum length of a match.</param>
+		/// <param name="maxSessions">Maximum number of sessions alive at once. At most INVALID_SESSION, so every ID is valid.</param>
+		/// <param name="threadCount">Number of worker threads. 0 uses every hardware thread.</param>
+		SessionHost(S rows, S columns, const std::vector<T>& possibleValues, int minMatchLength = 3u, size_t maxSessions = 1 << 16, unsigned int threadCount = 0)
+			: rowCount(rows), columnCount(columns), possibleValues(possibleValues), minimumMatchLength(minMatchLength),
+			maxSessionCount(std::min<size_t>(maxSessions, INVALID_SESSION)), blocks((maxSessionCount + SESSION_BLOCK_SIZE - 1) / SESSION_BLOCK_SIZE), pool(threadCount)
 		{
-			return IsAdjacent(pos1.row, pos1.column, pos2.row, pos2.column, matchDirections);
 		}
 
 		/// <summary>
-		/// Find matches in the table and return as groups of matches.
+		/// Finish every queued move before the sessions are destroyed.
 		/// </summary>
-		/// <param name="minMatchLength">Override for minimum length of a match.</param>
-		/// <param name="matchDirections">Match directions to check.</param>
-		/// <returns>A vector of match groups.</returns>
-		std::vector<MisketMatchGroup> FindMatchGroups(unsigned int minMatchLength = -1, MatchDirections matchDirections = MatchDirections()) const
+		~SessionHost()
 		{
-			if (minMatchLength == -1)
-			{
-				minMatchLength = minimumMatchLength;
-			}
+			pool.WaitIdle();
+		}
 
-			std::vector<MisketMatchGroup> matchGroups;
+		/// <summary>
+		/// Set the function called after every processed move.
+		/// Set this before submitting moves.
+		/// </summary>
+		/// <param name="callback">The function to call.</param>
+		void SetMoveCallback(MoveCallback callback)
+		{
+			moveCallback = std::move(callback);
+		}
 
-			auto collectMatch = [&](S startRow, S startCol, S dRow, S dCol)
+		/// <summary>
+		/// Create a session with a new random board.
+		/// </summary>
+		/// <remarks>
+		/// A recycled session gets a new table, so nothing of the last game's settings (move tracking, spawn weights,
+		/// gravity, holes, event observer...) carries over.
+		/// </remarks>
+		/// <returns>The ID of the new session, or INVALID_SESSION if the host is full.</returns>
+		SessionId CreateSession()
+		{
+			SessionId id;
+			bool recycled = false;
 			{
-				MisketMatchGroup currentGroup;
-				S row = startRow;
-				S col = startCol;
-				T prev = (*this)(row, col);
-				currentGroup.emplace_back(row, col);
+				std::lock_guard lock(hostMutex);
 
-				while (true)
+				if (!freeIds.empty())
 				{
-					row += dRow;
-					col += dCol;
-					if (row >= rowCount || col >= columnCount)
-					{
-						break;
-					}
-
-					const T& current = (*this)(row, col);
-					if (current == prev)
-					{
-						currentGroup.emplace_back(row, col);
-					}
-					else
-					{
-						if (currentGroup.size() >= minMatchLength)
-						{
-							matchGroups.emplace_back(std::move(currentGroup));
-						}
-						currentGroup.clear();
-						currentGroup.emplace_back(row, col);
-						prev = current;
-					}
+					id = freeIds.back();
+					freeIds.pop_back();
+					recycled = true;
 				}
-
-				if (currentGroup.size() >= minMatchLength)
+				else if (createdCount < maxSessionCount)
 				{
-					matchGroups.emplace_back(std::move(currentGroup));
-				}
-			};
+					id = static_cast<SessionId>(createdCount.load());
+					auto& block = blocks[id / SESSION_BLOCK_SIZE];
+					if (!block)
+						CreateBlock(block);
 
-			// Horizontal (Left to Right)
-			if (matchDirections.horizontal)
-			{
-				for (S row = 0; row < rowCount; ++row)
+					// Published after the block, for the lookups that don't take the lock
+					createdCount.store(id + 1);
+				}
+				else
 				{
-					collectMatch(row, 0, 0, 1);
+					return INVALID_SESSION;
 				}
+
+				++sessionCount;
 			}
 
-			// Vertical (Top to Bottom)
-			if (matchDirections.vertical)
+			Session& session = GetSession(id);
+			if (recycled)
 			{
-				for (S col = 0; col < columnCount; ++col)
-				{
-					collectMatch(0, col, 1, 0);
-				}
+				// Nothing else holds the session: it isn't alive, and its worker released it
+				session.table.emplace(rowCount, columnCount, possibleValues, minimumMatchLength, &blocks[id / SESSION_BLOCK_SIZE]->boards);
 			}
 
-			// Diagonal
-			if (matchDirections.diagonal)
-			{
-				// Top-Left to Bottom-Right
-				for (S row = 0; row <= rowCount - minMatchLength; ++row)
-				{
-					collectMatch(row, 0, 1, 1);
-				}
-				for (S col = 1; col <= columnCount - minMatchLength; ++col)
-				{
-					collectMatch(0, col, 1, 1);
-				}
+			Table<T, S>& table = *session.table;
 
-				// Top-Right to Bottom-Left
-				for (S row = 0; row <= rowCount - minMatchLength; ++row)
-				{
-					collectMatch(row, columnCount - 1, 1, -1);
-				}
-				for (S col = columnCount - 2; col + 1 >= minMatchLength; --col)
-				{
-					collectMatch(0, col, 1, -1);
-				}
+			auto& arena = GetScratchArena();
+			table.SetScratchResource(&arena);
+
+			table.Randomise(true);
+			if (!table.HasAnyValidMove())
+			{
+				table.Reshuffle();
 			}
 
-			return matchGroups;
+			table.SetScratchResource(nullptr);
+			arena.release();
+
+			std::lock_guard lock(session.mutex);
+			session.pending.clear();
+			session.alive = true;
+			return id;
 		}
 
-		/*
-		static std::vector<MisketMatchGroup> MergeOverlappingGroups(const std::vector<MisketMatchGroup>& groups)
+		/// <summary>
+		/// Destroy a session. Its queued moves are dropped.
+		/// </summary>
+		/// <remarks>
+		/// If a worker is processing the session, the session is recycled when the worker is done with it.
+		/// </remarks>
+		/// <param name="id">The ID of the session. Unknown IDs are ignored.</param>
+		void DestroySession(SessionId id)
 		{
-			using Pos = std::pair<S, S>;
-
-			std::vector<std::set<Pos>> mergedSets;
+			Session* found = FindSession(id);
+			if (found == nullptr)
+				return;
 
-			for (const auto& group : groups)
+			Session& session = *found;
 			{
-				std::set<Pos> current(group.begin(), group.end());
-				std::vector<S> overlaps;
+				std::lock_guard lock(session.mutex);
+				if (!session.alive)
+					return;
 
-				for (S i = 0; i < mergedSets.size(); ++i)
-				{
-					for (const auto& pos : current)
-					{
-						if (mergedSets[i].count(pos))
-						{
-							overlaps.push_back(i);
-							break;
-						}
-					}
-				}
+				session.alive = false;
+				session.pending.clear();
 
-				if (overlaps.empty())
-				{
-					mergedSets.push_back(std::move(current));
-				}
-				else
-				{
-					// Merge all overlapping sets and current into one
-					std::set<Pos> merged = std::move(current);
-					// Merge all overlapping sets
-					std::sort(overlaps.begin(), overlaps.end(), std::greater<>()); // reverse for safe erase
-					for (S index : overlaps)
-					{
-						merged.insert(mergedSets[index].begin(), mergedSets[index].end());
-						mergedSets.erase(mergedSets.begin() + index);
-					}
-					mergedSets.push_back(std::move(merged));
-				}
+				if (session.scheduled)
+					return;
 			}
 
-			// Convert sets back to vectors
-			std::vector<std::vector<Pos>> result;
-			for (const auto& s : mergedSets)
-				result.emplace_back(s.begin(), s.end());
-
-			return result;
+			ReleaseSession(id);
 		}
-		*/
 
 		/// <summary>
-		/// Checks if swapping two elements results in a match.
+		/// Queue a move for a session.
 		/// </summary>
-		/// <param name="row1">Row of first element</param>
-		/// <param name="col1">Column of first element</param>
-		/// <param name="row2">Row of second element</param>
-		/// <param name="col2">Column of second element</param>
-		/// <param name="minMatchLength">Override for minimum length of a match.</param>
-		/// <param name="matchDirections">Match directions to check.</param>
-		/// <returns>True if a match would occur after swap</returns>
-		bool WouldSwapCauseMatch(S row1, S col1, S row2, S col2, unsigned int minMatchLength = -1, MatchDirections matchDirections = MatchDirections())
+		/// <param name="id">The ID of the session.</param>
+		/// <param name="pos1">Position of the first misket to swap.</param>
+		/// <param name="pos2">Position of the second misket to swap.</param>
+		/// <returns>True if the move was queued, false if the session does not exist.</returns>
+		bool SubmitMove(SessionId id, MisketPosition pos1, MisketPosition pos2)
 		{
-			if (minMatchLength == -1)
-			{
-				minMatchLength = minimumMatchLength;
-			}
-
-			// Bounds check
-			if (row1 >= rowCount || row2 >= rowCount || col1 >= columnCount || col2 >= columnCount)
+			Session* found = FindSession(id);
+			if (found == nullptr)
 				return false;
 
-			if (row1 == row2 && col1 == col2)
-				return false;
-
-			// Swap the two elements
-			Swap(row1, col1, row2, col2);
+			Session& session = *found;
+			bool schedule = false;
+			{
+				std::lock_guard lock(session.mutex);
+				if (!session.alive)
+					return false;
 
-			// Check for matches after the swap
-			auto matches = FindMatchGroups(minMatchLength, matchDirections);
+				session.pending.push_back({ pos1, pos2, std::chrono::steady_clock::now() });
+				schedule = !session.scheduled;
+				session.scheduled = true;
+			}
 
-			// Undo the swap
-			Swap(row1, col1, row2, col2);
+			if (schedule)
+			{
+				pool.Submit([this, id]() { ProcessSession(id); });
+			}
 
-			return !matches.empty();
+			return true;
 		}
 
 		/// <summary>
-		/// Checks if swapping two elements results in a match.
+		/// Wait until every queued move is processed, including the moves submitted by the callback.
 		/// </summary>
-		/// <param name="pos1">Position of first element</param>
-		/// <param name="pos2">Position of second element</param>
-		/// <param name="minMatchLength">Override for minimum length of a match.</param>
-		/// <param name="matchDirections">Match directions to check.</param>
-		/// <returns>True if a match would occur after swap</returns>
-		bool WouldSwapCauseMatch(MisketPosition pos1, MisketPosition pos2, unsigned int minMatchLength = -1, MatchDirections matchDirections = MatchDirections())
+		void WaitIdle()
 		{
-			return WouldSwapCauseMatch(pos1.row, pos1.column, pos2.row, pos2.column, minMatchLength, matchDirections);
+			pool.WaitIdle();
 		}
 
 		/// <summary>
-		/// Swap two elements and return the matches that would occur.
+		/// Get the table of a session.
 		/// </summary>
 		/// <remarks>
-		/// Note that this does not check if the swap is valid.
-		/// Match Group returned may be empty.
+		/// Only safe while the session has no moves queued, e.g. after WaitIdle or in the move callback.
 		/// </remarks>
-		/// <param name="row1">Row of first element</param>
-		/// <param name="col1">Column of first element</param>
-		/// <param name="row2">Row of second element</param>
-		/// <param name="col2">Column of second element</param>
-		/// <param name="minMatchLength">Override for minimum length of a match.</param>
-		/// <param name="matchDirections">Match directions to check.</param>
-		/// <returns>Match groups that would occur after the swap</returns>
-		std::vector<MisketMatchGroup> SwapAndGetMatches(S row1, S col1, S row2, S col2, unsigned int minMatchLength = -1, MatchDirections matchDirections = MatchDirections())
+		/// <param name="id">The ID of the session.</param>
+		/// <returns>The table of the session, nullptr if the ID was never given out.</returns>
+		Table<T, S>* GetTable(SessionId id)
 		{
-			Swap(row1, col1, row2, col2);
-			auto matches = FindMatchGroups(minMatchLength, matchDirections);
-
-			if (matches.empty())
-			{
-				// No matches, undo the swap
-				Swap(row1, col1, row2, col2);
-			}
+			Session* session = FindSession(id);
+			return session != nullptr ? &*session->table : nullptr;
+		}
 
-			return matches;
+		/// <summary>
+		/// Get the number of sessions alive.
+		/// </summary>
+		/// <returns>The number of sessions alive.</returns>
+		size_t GetSessionCount()
+		{
+			std::lock_guard lock(hostMutex);
+			return sessionCount;
 		}
 
 		/// <summary>
-		/// Swap two elements and return the matches that would occur.
+		/// Get the number of worker threads.
 		/// </summary>
-		/// <remarks>
-		/// Note that this does not check if the swap is valid.
-		/// Match Group returned may be empty.
-		/// </remarks>
-		/// <param name="pos1">Position of first element.</param>
-		/// <param name="pos2">Position of second element.</param>
-		/// <param name="minMatchLength">Override for minimum length of a match.</param>
-		/// <param name="matchDirections">Match directions to check.</param>
-		/// <returns>Match groups that would occur after the swap.</returns>
-		std::vector<MisketMatchGroup> SwapAndGetMatches(MisketPosition pos1, MisketPosition pos2, unsigned int minMatchLength = -1, MatchDirections matchDirections = MatchDirections())
+		/// <returns>The number of worker threads.</returns>
+		unsigned int GetThreadCount() const
 		{
-			return SwapAndGetMatches(pos1.row, pos1.column, pos2.row, pos2.column, minMatchLength, matchDirections);
+			return pool.GetThreadCount();
 		}
 
 		/// <summary>
-		/// Pop the specified miskets from the table and collapse the columns.
+		/// Swap two miskets, then resolve every match and cascade.
+		/// Dead boards are reshuffled.
 		/// </summary>
-		/// <param name="positions">The positions of the miskets to pop.</param>
-		/// <param name="possibleRandomValues">Possible values for the new miskets.</param>
-		void PopMiskets(const std::vector<MisketPosition>& positions)
+		/// <param name="table">The table to play on.</param>
+		/// <param name="pos1">Position of the first misket to swap.</param>
+		/// <param name="pos2">Position of the second misket to swap.</param>
+		/// <returns>The result of the move. Latency is not filled.</returns>
+		static MoveResult PlayMove(Table<T, S>& table, MisketPosition pos1, MisketPosition pos2)
 		{
-			// Let's mark the positions of the miskets to be popped
-			std::vector<std::vector<bool>> marked(GetRowCount(), std::vector<bool>(GetColumnCount(), false));
-			for (const auto& pos : positions)
+			MoveResult result;
+
+			if (!table.IsActive(pos1) || !table.IsActive(pos2) || !table.IsAdjacent(pos1, pos2))
+				return result;
+
+			auto matches = table.SwapAndGetMatches(pos1, pos2);
+			if (matches.empty())
+				return result;
+
+			result.valid = true;
+
+			// The swap scanned the whole board, so the cascade only rescans the lines it changes
+			table.ClearDirtyLines();
+
+			const MisketPosition movedPositions[] = { pos1, pos2 };
+			std::span<const MisketPosition> moved = movedPositions;
+			while (!matches.empty())
 			{
-				if (pos.row < GetRowCount() && pos.column < GetColumnCount())
-					marked[pos.row][pos.column] = true;
+				const auto clear = table.ResolveMatchGroups(matches, moved);
+				result.clearedCount += static_cast<S>(clear.cleared.size());
+				++result.cascadeCount;
+
+				moved = {};
+				matches = table.FindDirtyMatchGroups();
 			}
 
-			// Collapse the marked columns
-			for (Scalar col = 0; col < GetColumnCount(); ++col)
+			if (!table.HasAnyValidMove())
 			{
-				// Collect non-marked values from bottom to top
-				std::vector<T> newColumn;
-				for (Scalar row = GetRowCount(); row-- > 0;)
-				{
-					if (!marked[row][col])
-						newColumn.push_back((*this)(row, col));
-				}
-
-				// Fill the column with the new values, bottom to top
-				Scalar index = 0;
-				for (Scalar row = GetRowCount(); row-- > 0;)
-				{
-					if (index < newColumn.size())
-					{
-						(*this)(row, col) = newColumn[index++];
-					}
-					else
-					{
-						// Generate new misket at the top
-						(*this)(row, col) = GenerateRandomMisket();
-					}
-				}
+				result.reshuffled = table.Reshuffle();
 			}
+
+			return result;
+		}
+
+	private:
+		Session& GetSession(SessionId id)
+		{
+			return blocks[id / SESSION_BLOCK_SIZE]->sessions[id % SESSION_BLOCK_SIZE];
 		}
 
 		/// <summary>
-		/// Pop the specified miskets from the table and collapse the columns.
-		/// </summary
-		/// <param name="matchGroups">The match groups to pop.</param>
-		void PopMisketMatchGroups(const std::vector<MisketMatchGroup>& matchGroups)
+		/// Get a session from an ID given by a caller.
+		/// </summary>
+		/// <returns>The session, nullptr if the ID was never given out (e.g. INVALID_SESSION).</returns>
+		Session* FindSession(SessionId id)
 		{
-			for (const auto& group : matchGroups)
+			if (id >= createdCount.load())
+				return nullptr;
+
+			return &GetSession(id);
+		}
+
+		/// <summary>
+		/// Allocate a block and build the tables of its sessions in the block's arena.
+		/// </summary>
+		void CreateBlock(std::unique_ptr<SessionBlock>& block)
+		{
+			const size_t cellCount = static_cast<size_t>(rowCount) * columnCount;
+			// Board, specials, refill queues, active masks by cell and by line, possible values and their weights
+			const size_t valueSize = sizeof(T) + sizeof(double) + sizeof(std::uint64_t) + sizeof(std::uint32_t);
+			const size_t tableSize = cellCount * (2 * sizeof(T) + sizeof(SpecialMisket)) + 5 * ((cellCount + 63) / 64 * sizeof(std::uint64_t))
+				+ possibleValues.size() * valueSize + 512;
+
+			block = std::make_unique<SessionBlock>(tableSize * SESSION_BLOCK_SIZE);
+			for (auto& session : block->sessions)
 			{
-				PopMiskets(group);
+				session.table.emplace(rowCount, columnCount, possibleValues, minimumMatchLength, &block->boards);
 			}
 		}
 
-	private:
 		/// <summary>
-		/// Get the index of a misket in the data vector based on its row and column.
+		/// Get the arena of the calling thread for the temporaries of one move.
 		/// </summary>
-		/// <param name="row">Row index</param>
-		/// <param name="column">Column index</param>
-		/// <returns>The index of the misket in the data vector.</returns>
-		S Index(S row, S column) const
+		static std::pmr::monotonic_buffer_resource& GetScratchArena()
 		{
-			return row * columnCount + column;
+			thread_local std::vector<std::byte> buffer(SCRATCH_ARENA_SIZE);
+			thread_local std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+			return arena;
 		}
 
 		/// <summary>
-		/// Get the index of a misket in the data vector based on its position.
+		/// Put a destroyed session back in the pool.
 		/// </summary>
-		/// <param name="pos">The position of the misket.</param>
-		/// <returns>The index of the misket in the data vector.</returns>
-		S Index(MisketPosition pos) const
+		void ReleaseSession(SessionId id)
 		{
-			return pos.row * columnCount + pos.column;
+			std::lock_guard lock(hostMutex);
+			freeIds.push_back(id);
+			--sessionCount;
+		}
+
+		/// <summary>
+		/// Process every queued move of a session. Runs on a worker.
+		/// </summary>
+		void ProcessSession(SessionId id)
+		{
+			Session& session = GetSession(id);
+
+			while (true)
+			{
+				{
+					std::unique_lock lock(session.mutex);
+					if (!session.alive)
+					{
+						// Destroyed while we were working on it
+						session.scheduled = false;
+						lock.unlock();
+						ReleaseSession(id);
+						return;
+					}
+
+					if (session.pending.empty())
+					{
+						session.scheduled = false;
+						return;
+					}
+
+					// Swap buffers, so submitting doesn't wait for processing
+					session.processing.clear();
+					std::swap(session.pending, session.processing);
+				}
+
+				Table<T, S>& table = *session.table;
+				auto& arena = GetScratchArena();
+
+				for (const auto& move : session.processing)
+				{
+					// Everything the move allocates is dropped at once when it is done
+					table.SetScratchResource(&arena);
+
+					MoveResult result = PlayMove(table, move.first, move.second);
+					result.latency = std::chrono::steady_clock::now() - move.submitTime;
+
+					if (moveCallback)
+					{
+						moveCallback(id, table, result);
+					}
+
+					table.SetScratchResource(nullptr);
+					arena.release();
+				}
+			}
 		}
 	};
 }
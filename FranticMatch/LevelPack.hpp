@@ -0,0 +1,806 @@
+// FranticDreamer 2025
+#pragma once
+
+// Level packs, many levels in one binary file that is read through a memory map.
+//
+// Opening a pack maps the file and checks its header and index. Nothing is parsed up front,
+// a level is decoded straight from the mapped bytes when it is viewed or loaded into a table.
+//
+// Levels that share their size, rules and possible values share one copy of them,
+// so a pack of many boards with the same rules is little more than their cell codes.
+//
+// File layout, little-endian. Offsets are from the start of the file.
+//   Header (24 bytes): "FMLP", uint16 version, uint16 value size,
+//                      uint32 level count, uint32 run count, uint64 index offset.
+//   Levels:            row-major cell codes, bit-packed from the lowest bit of each byte, each level padded to a whole byte.
+//                      A code is an index into the possible values of the level's rules, the value count itself marks a hole.
+//   Rules:             each on an 8 byte boundary. uint16 rows, uint16 columns,
+//                      uint8 minimum match length, uint8 match directions (bit 0 horizontal, bit 1 vertical, bit 2 diagonal),
+//                      uint8 bits per cell, uint8 value byte order (0 little-endian, 1 big-endian), uint16 value count,
+//                      6 reserved bytes, then the possible values.
+//   Index:             one 24 byte entry per run of levels that are stored back to back and share their rules:
+//                      uint64 offset of the run's first level, uint64 rules offset, uint32 index of the run's first level, uint32 reserved.
+//                      Runs are in level order, and the first one starts at level 0.
+//
+// Possible values are the raw bytes of the misket type in the byte order of the machine that wrote them,
+// since a misket type's layout isn't known to the pack. So a pack is read with the misket type it was written with,
+// and its levels don't load on a machine of the other byte order.
+
+#include <vector>
+#include <map>
+#include <span>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <memory>
+#include <memory_resource>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "FranticMatch.hpp"
+
+namespace FranticMatch
+{
+	namespace LevelPackFormat
+	{
+		constexpr std::uint16_t version = 3;
+		constexpr size_t headerSize = 24;
+		constexpr size_t entrySize = 24;
+		constexpr size_t rulesHeaderSize = 16;
+
+		// Rules start on this boundary, so possible values can be read in place
+		constexpr size_t rulesAlignment = 8;
+
+		constexpr std::uint8_t byteOrder = std::endian::native == std::endian::little ? 0 : 1;
+
+		constexpr std::uint8_t horizontalBit = 1;
+		constexpr std::uint8_t verticalBit = 2;
+		constexpr std::uint8_t diagonalBit = 4;
+
+		/// <summary>
+		/// Read a little-endian integer.
+		/// </summary>
+		template <typename U>
+		U GetLittleEndian(const std::uint8_t* bytes)
+		{
+			U value = 0;
+			for (size_t i = 0; i < sizeof(U); ++i)
+			{
+				value |= static_cast<U>(static_cast<U>(bytes[i]) << (8 * i));
+			}
+			return value;
+		}
+
+		/// <summary>
+		/// Append a little-endian integer to a buffer.
+		/// </summary>
+		template <typename U>
+		void PutLittleEndian(std::vector<std::uint8_t>& out, U value)
+		{
+			for (size_t i = 0; i < sizeof(U); ++i)
+			{
+				out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+			}
+		}
+	}
+
+	/// <summary>
+	/// Size, rules and cell coding of a level.
+	/// </summary>
+	struct LevelPackEntry
+	{
+		std::uint64_t offset = 0;
+		std::uint16_t rows = 0;
+		std::uint16_t columns = 0;
+		std::uint8_t minimumMatchLength = 3;
+		std::uint8_t matchDirections = LevelPackFormat::horizontalBit | LevelPackFormat::verticalBit;
+		std::uint8_t bitsPerCell = 1;
+		std::uint16_t valueCount = 0;
+
+		/// <summary>
+		/// Size of the cell codes, padded to a whole byte.
+		/// </summary>
+		size_t GetCellByteCount() const
+		{
+			return (static_cast<size_t>(rows) * columns * bitsPerCell + 7) / 8;
+		}
+
+		/// <summary>
+		/// Size of the possible values and the cell codes, as EncodeLevel lays a level out.
+		/// </summary>
+		template <typename T>
+		size_t GetByteCount() const
+		{
+			return valueCount * sizeof(T) + GetCellByteCount();
+		}
+	};
+
+	/// <summary>
+	/// A read-only memory map of a whole file.
+	/// </summary>
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept
+			: bytes(std::exchange(other.bytes, nullptr)), size(std::exchange(other.size, 0))
+		{
+		}
+
+		MappedFile& operator=(MappedFile&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Close();
+				bytes = std::exchange(other.bytes, nullptr);
+				size = std::exchange(other.size, 0);
+			}
+			return *this;
+		}
+
+		~MappedFile()
+		{
+			Close();
+		}
+
+		/// <summary>
+		/// Map a file, and unmap the one mapped before.
+		/// </summary>
+		/// <returns>Was the file mapped? Empty files can't be mapped.</returns>
+		bool Open(const std::string& path)
+		{
+			Close();
+
+#ifdef _WIN32
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+			{
+				CloseHandle(file);
+				return false;
+			}
+
+			// The view keeps the mapping alive, so both handles can go
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			CloseHandle(file);
+			if (mapping == nullptr)
+				return false;
+
+			const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+			if (view == nullptr)
+				return false;
+
+			size = static_cast<size_t>(fileSize.QuadPart);
+#else
+			const int file = open(path.c_str(), O_RDONLY);
+			if (file < 0)
+				return false;
+
+			struct stat status;
+			if (fstat(file, &status) != 0 || status.st_size <= 0)
+			{
+				close(file);
+				return false;
+			}
+
+			// The mapping keeps the file alive, so the descriptor can go
+			void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			close(file);
+			if (view == MAP_FAILED)
+				return false;
+
+			size = static_cast<size_t>(status.st_size);
+#endif
+
+			bytes = static_cast<const std::uint8_t*>(view);
+			return true;
+		}
+
+		/// <summary>
+		/// Unmap the file. Views into it are left dangling.
+		/// </summary>
+		void Close()
+		{
+			if (bytes == nullptr)
+				return;
+
+#ifdef _WIN32
+			UnmapViewOfFile(bytes);
+#else
+			munmap(const_cast<std::uint8_t*>(bytes), size);
+#endif
+			bytes = nullptr;
+			size = 0;
+		}
+
+		bool IsOpen() const
+		{
+			return bytes != nullptr;
+		}
+
+		std::span<const std::uint8_t> GetBytes() const
+		{
+			return { bytes, size };
+		}
+
+	private:
+		const std::uint8_t* bytes = nullptr;
+		size_t size = 0;
+	};
+
+	/// <summary>
+	/// A read-only view of one level, decoded from the pack's bytes on access.
+	/// </summary>
+	/// <remarks>
+	/// The view points into the mapped file, so it is only valid while its pack is open.
+	/// </remarks>
+	/// <typeparam name="T">Type of the miskets.</typeparam>
+	template <typename T>
+	class LevelView
+	{
+	public:
+		LevelView() = default;
+
+		LevelView(const LevelPackEntry& entry, const std::uint8_t* values, const std::uint8_t* cells)
+			: entry(entry), values(values), cells(cells)
+		{
+		}
+
+		Scalar GetRowCount() const
+		{
+			return entry.rows;
+		}
+
+		Scalar GetColumnCount() const
+		{
+			return entry.columns;
+		}
+
+		unsigned int GetMinimumMatchLength() const
+		{
+			return entry.minimumMatchLength;
+		}
+
+		/// <summary>
+		/// Get the match directions of the level, as the table type's own structure.
+		/// </summary>
+		/// <typeparam name="MatchDirections">MatchDirections of the table the level is played on.</typeparam>
+		template <typename MatchDirections>
+		MatchDirections GetMatchDirections() const
+		{
+			MatchDirections matchDirections;
+			matchDirections.horizontal = entry.matchDirections & LevelPackFormat::horizontalBit;
+			matchDirections.vertical = entry.matchDirections & LevelPackFormat::verticalBit;
+			matchDirections.diagonal = entry.matchDirections & LevelPackFormat::diagonalBit;
+			return matchDirections;
+		}
+
+		size_t GetValueCount() const
+		{
+			return entry.valueCount;
+		}
+
+		/// <summary>
+		/// Get one of the possible values of the level.
+		/// </summary>
+		T GetValue(size_t valueIndex) const
+		{
+			T value;
+			std::memcpy(&value, values + valueIndex * sizeof(T), sizeof(T));
+			return value;
+		}
+
+		/// <summary>
+		/// Copy the possible values of the level.
+		/// </summary>
+		std::vector<T> GetPossibleValues() const
+		{
+			std::vector<T> possibleValues(entry.valueCount);
+			std::memcpy(possibleValues.data(), values, possibleValues.size() * sizeof(T));
+			return possibleValues;
+		}
+
+		/// <summary>
+		/// Get the code of a cell: an index into the possible values, or the value count for a hole.
+		/// </summary>
+		std::uint32_t GetCode(Scalar row, Scalar column) const
+		{
+			return CodeAt((static_cast<size_t>(row) * entry.columns + column) * entry.bitsPerCell);
+		}
+
+		bool IsActive(Scalar row, Scalar column) const
+		{
+			return GetCode(row, column) < entry.valueCount;
+		}
+
+		/// <summary>
+		/// Get a misket of the level. Holes read as a default constructed misket.
+		/// </summary>
+		T Get(Scalar row, Scalar column) const
+		{
+			const std::uint32_t code = GetCode(row, column);
+			return code < entry.valueCount ? GetValue(code) : T();
+		}
+
+		/// <summary>
+		/// Build a table for the level, with its size, possible values, minimum match length and holes.
+		/// </summary>
+		/// <remarks>
+		/// Cells are decoded in one pass straight into the table's rows.
+		/// Match directions aren't part of a table, get them with GetMatchDirections.
+		/// </remarks>
+		/// <typeparam name="TableType">Table to build, any Table of the same misket type.</typeparam>
+		/// <param name="resource">Memory resource of the table.</param>
+		template <typename TableType = Table<T>>
+		TableType MakeTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const
+		{
+			const std::vector<T> possibleValues = GetPossibleValues();
+			TableType table(entry.rows, entry.columns, possibleValues, entry.minimumMatchLength, resource);
+
+			size_t bit = 0;
+			for (Scalar row = 0; row < entry.rows; ++row)
+			{
+				T* rowValues = table[row];
+				for (Scalar col = 0; col < entry.columns; ++col, bit += entry.bitsPerCell)
+				{
+					const std::uint32_t code = CodeAt(bit);
+					if (code < entry.valueCount)
+						rowValues[col] = possibleValues[code];
+					else
+						table.SetActive(row, col, false);
+				}
+			}
+
+			return table;
+		}
+
+	private:
+		std::uint32_t CodeAt(size_t bit) const
+		{
+			// A code spans three bytes at most, since codes are 16 bits or less
+			const size_t byte = bit / 8;
+			const size_t byteCount = entry.GetCellByteCount();
+
+			std::uint32_t word = 0;
+			for (size_t i = 0; i < 3 && byte + i < byteCount; ++i)
+			{
+				word |= static_cast<std::uint32_t>(cells[byte + i]) << (8 * i);
+			}
+
+			return (word >> (bit % 8)) & ((1u << entry.bitsPerCell) - 1);
+		}
+
+		LevelPackEntry entry;
+		const std::uint8_t* values = nullptr;
+		const std::uint8_t* cells = nullptr;
+	};
+
+	/// <summary>
+	/// A memory mapped level pack.
+	/// </summary>
+	/// <typeparam name="T">Type of the miskets. Stored as raw bytes, so it has to be trivially copyable.</typeparam>
+	template <typename T>
+	class LevelPack
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Level packs store miskets as raw bytes");
+
+	public:
+		/// <summary>
+		/// Map a pack and check its header and index.
+		/// Levels are checked when they are read.
+		/// </summary>
+		/// <returns>Is the file a pack of this misket type?</returns>
+		bool Open(const std::string& path)
+		{
+			Close();
+			if (!file.Open(path))
+				return false;
+
+			const std::span<const std::uint8_t> bytes = file.GetBytes();
+			if (bytes.size() < LevelPackFormat::headerSize || std::memcmp(bytes.data(), "FMLP", 4) != 0
+				|| LevelPackFormat::GetLittleEndian<std::uint16_t>(bytes.data() + 4) != LevelPackFormat::version
+				|| LevelPackFormat::GetLittleEndian<std::uint16_t>(bytes.data() + 6) != sizeof(T))
+			{
+				Close();
+				return false;
+			}
+
+			const std::uint32_t count = LevelPackFormat::GetLittleEndian<std::uint32_t>(bytes.data() + 8);
+			const std::uint32_t runs = LevelPackFormat::GetLittleEndian<std::uint32_t>(bytes.data() + 12);
+			const std::uint64_t indexOffset = LevelPackFormat::GetLittleEndian<std::uint64_t>(bytes.data() + 16);
+			if (indexOffset > bytes.size() || (bytes.size() - indexOffset) / LevelPackFormat::entrySize < runs
+				|| (count > 0 && (runs == 0 || LevelPackFormat::GetLittleEndian<std::uint32_t>(bytes.data() + indexOffset + 16) != 0)))
+			{
+				Close();
+				return false;
+			}
+
+			levelCount = count;
+			runCount = runs;
+			index = bytes.data() + indexOffset;
+			return true;
+		}
+
+		void Close()
+		{
+			file.Close();
+			levelCount = 0;
+			runCount = 0;
+			index = nullptr;
+		}
+
+		bool IsOpen() const
+		{
+			return file.IsOpen();
+		}
+
+		size_t GetLevelCount() const
+		{
+			return levelCount;
+		}
+
+		/// <summary>
+		/// Get a view of a level.
+		/// </summary>
+		/// <param name="levelIndex">Index of the level in the pack.</param>
+		/// <param name="level">The view, valid while the pack is open.</param>
+		/// <returns>False if there is no such level, or its rules or cells don't fit the file.</returns>
+		bool GetLevel(size_t levelIndex, LevelView<T>& level) const
+		{
+			if (levelIndex >= levelCount)
+				return false;
+
+			// The last run that starts at or before the level. Open checked the first one starts at level 0
+			size_t low = 0;
+			size_t high = runCount;
+			while (high - low > 1)
+			{
+				const size_t middle = low + (high - low) / 2;
+				if (GetFirstLevel(middle) <= levelIndex)
+					low = middle;
+				else
+					high = middle;
+			}
+
+			const std::uint8_t* run = index + low * LevelPackFormat::entrySize;
+			const std::uint64_t levelOffset = LevelPackFormat::GetLittleEndian<std::uint64_t>(run);
+			const std::uint64_t rulesOffset = LevelPackFormat::GetLittleEndian<std::uint64_t>(run + 8);
+			const size_t levelInRun = levelIndex - GetFirstLevel(low);
+
+			const std::span<const std::uint8_t> mapped = file.GetBytes();
+			if (rulesOffset > mapped.size() || mapped.size() - rulesOffset < LevelPackFormat::rulesHeaderSize)
+				return false;
+
+			const std::uint8_t* rules = mapped.data() + rulesOffset;
+
+			LevelPackEntry entry;
+			entry.rows = LevelPackFormat::GetLittleEndian<std::uint16_t>(rules);
+			entry.columns = LevelPackFormat::GetLittleEndian<std::uint16_t>(rules + 2);
+			entry.minimumMatchLength = rules[4];
+			entry.matchDirections = rules[5];
+			entry.bitsPerCell = rules[6];
+			entry.valueCount = LevelPackFormat::GetLittleEndian<std::uint16_t>(rules + 8);
+
+			// Every code up to the hole code has to fit in a cell, and the values have to be readable here
+			const size_t cellBytes = entry.GetCellByteCount();
+			if (entry.bitsPerCell < 1 || entry.bitsPerCell > 16 || (1u << entry.bitsPerCell) <= entry.valueCount
+				|| rules[7] != LevelPackFormat::byteOrder
+				|| mapped.size() - rulesOffset - LevelPackFormat::rulesHeaderSize < entry.valueCount * sizeof(T)
+				|| levelOffset > mapped.size() || (cellBytes > 0 && (mapped.size() - levelOffset) / cellBytes <= levelInRun))
+				return false;
+
+			level = LevelView<T>(entry, rules + LevelPackFormat::rulesHeaderSize, mapped.data() + levelOffset + levelInRun * cellBytes);
+			return true;
+		}
+
+		/// <summary>
+		/// Build a table for a level, see LevelView::MakeTable.
+		/// </summary>
+		/// <remarks>
+		/// The table is rebuilt in place, so it takes the given resource.
+		/// Assigning would keep the old table's resource, since memory resources don't move with assignment.
+		/// </remarks>
+		/// <param name="levelIndex">Index of the level in the pack.</param>
+		/// <param name="table">Replaced with the level's table.</param>
+		/// <param name="matchDirections">Set to the level's match directions.</param>
+		/// <param name="resource">Memory resource of the new table.</param>
+		/// <returns>False if the level can't be read, the table is left as it was then.</returns>
+		template <typename TableType>
+		bool LoadLevel(size_t levelIndex, TableType& table, typename TableType::MatchDirections& matchDirections,
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const
+		{
+			LevelView<T> level;
+			if (!GetLevel(levelIndex, level))
+				return false;
+
+			TableType loaded = level.template MakeTable<TableType>(resource);
+			std::destroy_at(&table);
+			std::construct_at(&table, std::move(loaded));
+			matchDirections = level.template GetMatchDirections<typename TableType::MatchDirections>();
+			return true;
+		}
+
+	private:
+		size_t GetFirstLevel(size_t run) const
+		{
+			return LevelPackFormat::GetLittleEndian<std::uint32_t>(index + run * LevelPackFormat::entrySize + 16);
+		}
+
+		MappedFile file;
+		size_t levelCount = 0;
+		size_t runCount = 0;
+		const std::uint8_t* index = nullptr;
+	};
+
+	/// <summary>
+	/// Writes level packs.
+	/// </summary>
+	/// <remarks>
+	/// Levels are encoded into a buffer first, so many threads can encode and one of them writes.
+	/// Only cells are written as levels come in. Rules are kept once each in memory,
+	/// and written by Finish along with the index and the level count.
+	/// </remarks>
+	/// <typeparam name="T">Type of the miskets. Stored as raw bytes, so it has to be trivially copyable.</typeparam>
+	template <typename T>
+	class LevelPackWriter
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Level packs store miskets as raw bytes");
+
+	public:
+		/// <summary>
+		/// Create the file and write a header with no levels.
+		/// </summary>
+		/// <returns>Was the file created?</returns>
+		bool Open(const std::string& path)
+		{
+			stream = std::ofstream(path, std::ios::binary | std::ios::trunc);
+			runs.clear();
+			rules.clear();
+			rulesOffsets.clear();
+			levelCount = 0;
+			position = 0;
+
+			std::vector<std::uint8_t> header;
+			header.insert(header.end(), { 'F', 'M', 'L', 'P' });
+			LevelPackFormat::PutLittleEndian<std::uint16_t>(header, LevelPackFormat::version);
+			LevelPackFormat::PutLittleEndian<std::uint16_t>(header, sizeof(T));
+
+			// Level count and index offset are written when the pack is finished
+			header.resize(LevelPackFormat::headerSize, 0);
+			return WriteBytes(header);
+		}
+
+		/// <summary>
+		/// Encode a table as a level and append it to a buffer.
+		/// Holes are kept, specials and payloads are not.
+		/// </summary>
+		/// <param name="table">The level's table. Every active misket has to be one of its possible values.</param>
+		/// <param name="matchDirections">Match directions of the level.</param>
+		/// <param name="records">Buffer to append the level to, its possible values and then its cell codes.</param>
+		/// <param name="recordEntries">Buffer to append the level's entry to. Its offset is from the start of the records.</param>
+		/// <returns>False if the level doesn't fit the format, the buffers are left as they were then.</returns>
+		template <typename TableType>
+		static bool EncodeLevel(const TableType& table, typename TableType::MatchDirections matchDirections,
+			std::vector<std::uint8_t>& records, std::vector<LevelPackEntry>& recordEntries)
+		{
+			const std::span<const T> possibleValues = table.GetPossibleValues();
+			if (table.GetRowCount() > 0xFFFF || table.GetColumnCount() > 0xFFFF
+				|| possibleValues.size() >= 0xFFFF || table.GetMinimumMatchLength() > 0xFF)
+				return false;
+
+			LevelPackEntry entry;
+			entry.offset = records.size();
+			entry.rows = static_cast<std::uint16_t>(table.GetRowCount());
+			entry.columns = static_cast<std::uint16_t>(table.GetColumnCount());
+			entry.minimumMatchLength = static_cast<std::uint8_t>(table.GetMinimumMatchLength());
+			entry.matchDirections = (matchDirections.horizontal ? LevelPackFormat::horizontalBit : 0)
+				| (matchDirections.vertical ? LevelPackFormat::verticalBit : 0)
+				| (matchDirections.diagonal ? LevelPackFormat::diagonalBit : 0);
+			entry.valueCount = static_cast<std::uint16_t>(possibleValues.size());
+
+			// The value count is the hole code, so it needs a code of its own
+			entry.bitsPerCell = static_cast<std::uint8_t>(std::max(1u, static_cast<unsigned int>(std::bit_width(static_cast<unsigned int>(entry.valueCount)))));
+
+			const size_t start = records.size();
+			records.resize(start + entry.GetByteCount<T>(), 0);
+			std::memcpy(records.data() + start, possibleValues.data(), possibleValues.size() * sizeof(T));
+
+			std::uint8_t* cells = records.data() + start + possibleValues.size() * sizeof(T);
+			size_t bit = 0;
+			for (Scalar row = 0; row < table.GetRowCount(); ++row)
+			{
+				for (Scalar col = 0; col < table.GetColumnCount(); ++col, bit += entry.bitsPerCell)
+				{
+					std::uint32_t code = entry.valueCount;
+					if (table.IsActive(row, col))
+					{
+						const auto it = std::find(possibleValues.begin(), possibleValues.end(), table.Get(row, col));
+						if (it == possibleValues.end())
+						{
+							records.resize(start);
+							return false;
+						}
+						code = static_cast<std::uint32_t>(it - possibleValues.begin());
+					}
+
+					// A code spans three bytes at most, since codes are 16 bits or less
+					const std::uint32_t shifted = code << (bit % 8);
+					for (size_t i = 0; i < (bit % 8 + entry.bitsPerCell + 7) / 8; ++i)
+					{
+						cells[bit / 8 + i] |= static_cast<std::uint8_t>(shifted >> (8 * i));
+					}
+				}
+			}
+
+			recordEntries.push_back(entry);
+			return true;
+		}
+
+		/// <summary>
+		/// Append encoded levels to the pack.
+		/// </summary>
+		/// <param name="records">Levels from EncodeLevel.</param>
+		/// <param name="recordEntries">Their entries, with offsets from the start of the records.</param>
+		bool Write(std::span<const std::uint8_t> records, std::span<const LevelPackEntry> recordEntries)
+		{
+			cells.clear();
+			for (const LevelPackEntry& entry : recordEntries)
+			{
+				const std::uint8_t* record = records.data() + entry.offset;
+				const std::uint64_t rulesOffset = AddRules(entry, record);
+
+				// Levels are written back to back, so a level with the rules of the one before extends its run
+				if (runs.empty() || runs.back().rulesOffset != rulesOffset)
+					runs.push_back({ position + cells.size(), rulesOffset, levelCount });
+
+				cells.insert(cells.end(), record + entry.valueCount * sizeof(T), record + entry.GetByteCount<T>());
+				++levelCount;
+			}
+			return WriteBytes(cells);
+		}
+
+		/// <summary>
+		/// Write the rules, the index and the header, and close the file.
+		/// </summary>
+		/// <returns>Was everything written?</returns>
+		bool Finish()
+		{
+			const std::vector<std::uint8_t> padding((LevelPackFormat::rulesAlignment - position % LevelPackFormat::rulesAlignment) % LevelPackFormat::rulesAlignment, 0);
+			WriteBytes(padding);
+
+			const std::uint64_t rulesStart = position;
+			WriteBytes(rules);
+
+			const std::uint64_t indexOffset = position;
+
+			std::vector<std::uint8_t> index;
+			index.reserve(runs.size() * LevelPackFormat::entrySize);
+			for (const Run& run : runs)
+			{
+				LevelPackFormat::PutLittleEndian<std::uint64_t>(index, run.levelOffset);
+				LevelPackFormat::PutLittleEndian<std::uint64_t>(index, rulesStart + run.rulesOffset);
+				LevelPackFormat::PutLittleEndian<std::uint32_t>(index, static_cast<std::uint32_t>(run.firstLevel));
+				LevelPackFormat::PutLittleEndian<std::uint32_t>(index, 0);
+			}
+			WriteBytes(index);
+
+			std::vector<std::uint8_t> counts;
+			LevelPackFormat::PutLittleEndian<std::uint32_t>(counts, static_cast<std::uint32_t>(levelCount));
+			LevelPackFormat::PutLittleEndian<std::uint32_t>(counts, static_cast<std::uint32_t>(runs.size()));
+			LevelPackFormat::PutLittleEndian<std::uint64_t>(counts, indexOffset);
+
+			stream.seekp(LevelPackFormat::headerSize - counts.size());
+			stream.write(reinterpret_cast<const char*>(counts.data()), counts.size());
+			stream.close();
+			return !stream.fail();
+		}
+
+		size_t GetLevelCount() const
+		{
+			return levelCount;
+		}
+
+		/// <summary>
+		/// Bytes written so far. After Finish, the size of the file.
+		/// </summary>
+		std::uint64_t GetSize() const
+		{
+			return position;
+		}
+
+	private:
+		/// <summary>
+		/// Levels stored back to back with the same rules.
+		/// </summary>
+		struct Run
+		{
+			std::uint64_t levelOffset = 0;
+
+			// From the start of the rules
+			std::uint64_t rulesOffset = 0;
+
+			size_t firstLevel = 0;
+		};
+
+		/// <summary>
+		/// Orders rules records by size, then by bytes.
+		/// </summary>
+		struct RulesOrder
+		{
+			bool operator()(const std::vector<std::uint8_t>& a, const std::vector<std::uint8_t>& b) const
+			{
+				// Records are never empty, they start with a fixed size header
+				return a.size() != b.size() ? a.size() < b.size() : std::memcmp(a.data(), b.data(), a.size()) < 0;
+			}
+		};
+
+		/// <summary>
+		/// Find the rules of a level, or add them if no level had them before.
+		/// </summary>
+		/// <param name="values">The level's possible values.</param>
+		/// <returns>Offset of the rules from the start of the rules.</returns>
+		std::uint64_t AddRules(const LevelPackEntry& entry, const std::uint8_t* values)
+		{
+			rulesRecord.clear();
+			LevelPackFormat::PutLittleEndian<std::uint16_t>(rulesRecord, entry.rows);
+			LevelPackFormat::PutLittleEndian<std::uint16_t>(rulesRecord, entry.columns);
+			LevelPackFormat::PutLittleEndian<std::uint8_t>(rulesRecord, entry.minimumMatchLength);
+			LevelPackFormat::PutLittleEndian<std::uint8_t>(rulesRecord, entry.matchDirections);
+			LevelPackFormat::PutLittleEndian<std::uint8_t>(rulesRecord, entry.bitsPerCell);
+			LevelPackFormat::PutLittleEndian<std::uint8_t>(rulesRecord, LevelPackFormat::byteOrder);
+			LevelPackFormat::PutLittleEndian<std::uint16_t>(rulesRecord, entry.valueCount);
+			rulesRecord.resize(LevelPackFormat::rulesHeaderSize, 0);
+			rulesRecord.insert(rulesRecord.end(), values, values + entry.valueCount * sizeof(T));
+			rulesRecord.resize((rulesRecord.size() + LevelPackFormat::rulesAlignment - 1) / LevelPackFormat::rulesAlignment * LevelPackFormat::rulesAlignment, 0);
+
+			const auto [it, added] = rulesOffsets.try_emplace(rulesRecord, rules.size());
+			if (added)
+				rules.insert(rules.end(), rulesRecord.begin(), rulesRecord.end());
+			return it->second;
+		}
+
+		bool WriteBytes(std::span<const std::uint8_t> bytes)
+		{
+			stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+			position += bytes.size();
+			return stream.good();
+		}
+
+		std::ofstream stream;
+		std::vector<Run> runs;
+		std::vector<std::uint8_t> rules;
+		std::map<std::vector<std::uint8_t>, std::uint64_t, RulesOrder> rulesOffsets;
+		size_t levelCount = 0;
+		std::uint64_t position = 0;
+
+		// Scratch space of Write and AddRules
+		std::vector<std::uint8_t> cells;
+		std::vector<std::uint8_t> rulesRecord;
+	};
+}
@@ -0,0 +1,13 @@
+# FranticDreamer 2025
+
+# ---
+# FranticMatch Level Generator Files
+# ---
+
+set (FRANTICMATCH_LEVELGENERATOR_SOURCEDIR "FranticMatch_LevelGenerator/Source")
+
+# Source files
+file (GLOB FRANTICMATCH_LEVELGENERATOR_SOURCEFILES
+
+	${FRANTICMATCH_LEVELGENERATOR_SOURCEDIR}/Main.cpp
+	)
\ No newline at end of file
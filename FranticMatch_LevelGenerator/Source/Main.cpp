@@ -0,0 +1,309 @@
+// FranticDreamer 2025
+
+// This is a bulk level generator.
+//
+// Every thread rolls random starting boards with its own random stream,
+// and keeps the ones that have no matches, at least the given number of valid moves,
+// and every colour within a tolerance of an even share of the cells.
+// Cheap checks run first, and each check stops as soon as it knows the answer.
+// Accepted boards are encoded on their threads and streamed to the output file in chunks.
+//
+// The output is a level pack (see FranticMatch/LevelPack.hpp) of int miskets,
+// with the colours 0 to colourCount - 1, a minimum match length of 3 and horizontal and vertical matches.
+// Every board has the same rules, so the pack stores them once and is one run of bit-packed boards.
+//
+// Usage: FranticMatch_LevelGenerator <output> [boardCount] [rows] [columns] [colourCount] [minValidMoves] [balanceTolerance] [seed] [threadCount]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#include "FranticMatch/FranticMatch.hpp"
+#include "FranticMatch/LevelPack.hpp"
+
+namespace
+{
+	using Table = FranticMatch::Table<int>;
+	using PackWriter = FranticMatch::LevelPackWriter<int>;
+
+	// Boards a thread collects before it writes them out
+	constexpr size_t chunkBoardCount = 256;
+
+	/// <summary>
+	/// Generation settings, from the command line.
+	/// </summary>
+	struct Options
+	{
+		std::string outputPath;
+		size_t boardCount = 100000;
+		FranticMatch::Scalar rows = 8;
+		FranticMatch::Scalar columns = 8;
+		unsigned int colourCount = 6;
+		FranticMatch::Scalar minValidMoves = 3;
+		double balanceTolerance = 0.25;
+		std::uint64_t seed = 2025;
+		unsigned int threadCount = 0;
+	};
+
+	/// <summary>
+	/// Rejection counts of one thread.
+	/// </summary>
+	struct WorkerStats
+	{
+		size_t generated = 0;
+		size_t rejectedBalance = 0;
+		size_t rejectedMoves = 0;
+	};
+
+	/// <summary>
+	/// Mix a seed, so neighbouring thread indices get unrelated streams.
+	/// </summary>
+	std::uint64_t MixSeed(std::uint64_t value)
+	{
+		// SplitMix64 finaliser
+		value += 0x9E3779B97F4A7C15ull;
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+
+	/// <summary>
+	/// Writes levels to the output pack from any thread.
+	/// </summary>
+	class LevelWriter
+	{
+	public:
+		explicit LevelWriter(const Options& options)
+		{
+			isOpen = writer.Open(options.outputPath);
+		}
+
+		bool IsOpen() const
+		{
+			return isOpen;
+		}
+
+		/// <summary>
+		/// Append a chunk of encoded levels.
+		/// </summary>
+		void Write(const std::vector<std::uint8_t>& records, const std::vector<FranticMatch::LevelPackEntry>& entries)
+		{
+			std::lock_guard lock(mutex);
+			isOpen = writer.Write(records, entries) && isOpen;
+		}
+
+		/// <summary>
+		/// Mark the pack as failed, Finish reports it.
+		/// </summary>
+		void Fail()
+		{
+			std::lock_guard lock(mutex);
+			isOpen = false;
+		}
+
+		/// <summary>
+		/// Write the index and close the file.
+		/// </summary>
+		/// <returns>Was everything written?</returns>
+		bool Finish()
+		{
+			return writer.Finish() && isOpen;
+		}
+
+		size_t GetBoardCount() const
+		{
+			return writer.GetLevelCount();
+		}
+
+		std::uint64_t GetFileSize() const
+		{
+			return writer.GetSize();
+		}
+
+	private:
+		PackWriter writer;
+		std::mutex mutex;
+		bool isOpen = false;
+	};
+
+	/// <summary>
+	/// Check every colour is within the tolerance of an even share.
+	/// Stops as soon as a colour goes over its limit.
+	/// </summary>
+	/// <param name="counts">Scratch space, one entry per colour.</param>
+	bool IsBalanced(const Table& table, const Options& options, std::vector<size_t>& counts)
+	{
+		const double share = static_cast<double>(table.GetActiveCount()) / options.colourCount;
+		const size_t maxCount = static_cast<size_t>(std::floor(share * (1.0 + options.balanceTolerance)));
+		const size_t minCount = static_cast<size_t>(std::max(0.0, std::ceil(share * (1.0 - options.balanceTolerance))));
+
+		std::fill(counts.begin(), counts.end(), 0);
+		for (FranticMatch::Scalar row = 0; row < table.GetRowCount(); ++row)
+		{
+			for (FranticMatch::Scalar col = 0; col < table.GetColumnCount(); ++col)
+			{
+				if (++counts[table.Get(row, col)] > maxCount)
+					return false;
+			}
+		}
+
+		return std::all_of(counts.begin(), counts.end(), [&](size_t count) { return count >= minCount; });
+	}
+
+	/// <summary>
+	/// Generate boards until the target count is claimed.
+	/// </summary>
+	/// <param name="claimed">Accepted boards of every thread. A board is only written if it claims a slot below the target.</param>
+	void GenerateLevels(const Options& options, unsigned int threadIndex, std::atomic<size_t>& claimed, LevelWriter& writer, WorkerStats& stats)
+	{
+		// The generator is per thread, so the seed only affects this thread's boards
+		Table::SeedRandom(MixSeed(options.seed ^ MixSeed(threadIndex)));
+
+		std::vector<int> possibleValues(options.colourCount);
+		std::iota(possibleValues.begin(), possibleValues.end(), 0);
+
+		Table table(options.rows, options.columns, possibleValues, 3);
+
+		std::vector<size_t> counts(options.colourCount);
+		std::vector<std::uint8_t> chunk;
+		std::vector<FranticMatch::LevelPackEntry> chunkEntries;
+
+		while (claimed.load(std::memory_order_relaxed) < options.boardCount)
+		{
+			// Randomise leaves no matches on the board
+			table.Randomise();
+			++stats.generated;
+
+			if (!IsBalanced(table, options, counts))
+			{
+				++stats.rejectedBalance;
+				continue;
+			}
+
+			if (!table.HasValidMoves(options.minValidMoves))
+			{
+				++stats.rejectedMoves;
+				continue;
+			}
+
+			// Encode before claiming a slot, so every claimed slot is written
+			const size_t chunkSize = chunk.size();
+			if (!PackWriter::EncodeLevel(table, Table::MatchDirections(), chunk, chunkEntries))
+			{
+				// Options are checked against the format up front, so this is a bug
+				writer.Fail();
+				break;
+			}
+
+			if (claimed.fetch_add(1, std::memory_order_relaxed) >= options.boardCount)
+			{
+				chunk.resize(chunkSize);
+				chunkEntries.pop_back();
+				break;
+			}
+
+			if (chunkEntries.size() == chunkBoardCount)
+			{
+				writer.Write(chunk, chunkEntries);
+				chunk.clear();
+				chunkEntries.clear();
+			}
+		}
+
+		if (!chunkEntries.empty())
+		{
+			writer.Write(chunk, chunkEntries);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: FranticMatch_LevelGenerator <output> [boardCount] [rows] [columns] [colourCount] [minValidMoves] [balanceTolerance] [seed] [threadCount]\n";
+		return 1;
+	}
+
+	Options options;
+	options.outputPath = argv[1];
+	if (argc > 2) options.boardCount = std::stoul(argv[2]);
+	if (argc > 3) options.rows = std::stoi(argv[3]);
+	if (argc > 4) options.columns = std::stoi(argv[4]);
+	if (argc > 5) options.colourCount = std::stoul(argv[5]);
+	if (argc > 6) options.minValidMoves = std::stoi(argv[6]);
+	if (argc > 7) options.balanceTolerance = std::stod(argv[7]);
+	if (argc > 8) options.seed = std::stoull(argv[8]);
+	if (argc > 9) options.threadCount = std::stoul(argv[9]);
+
+	// Re-rolling a two colour board rarely ends.
+	// The table indexes cells and swap slots, four per cell, with int
+	if (options.rows < 1 || options.rows > 0xFFFF || options.columns < 1 || options.columns > 0xFFFF
+		|| static_cast<long long>(options.rows) * options.columns * 4 > INT_MAX
+		|| options.colourCount < 3 || options.colourCount > 0xFFFE || options.boardCount > 0xFFFFFFFFu)
+	{
+		std::cerr << "Boards must be 1 to 65535 cells wide, with at most " << INT_MAX / 4 << " cells, 3 to 65534 colours and at most 4294967295 boards.\n";
+		return 1;
+	}
+
+	if (options.threadCount == 0)
+		options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	LevelWriter writer(options);
+	if (!writer.IsOpen())
+	{
+		std::cerr << "Can't open " << options.outputPath << "\n";
+		return 1;
+	}
+
+	std::cout << "FranticMatch level generator\n";
+	std::cout << "Boards: " << options.boardCount << " of " << options.rows << "x" << options.columns
+		<< ", colours: " << options.colourCount << ", min valid moves: " << options.minValidMoves
+		<< ", balance tolerance: " << options.balanceTolerance << ", threads: " << options.threadCount << "\n\n";
+
+	std::atomic<size_t> claimed = 0;
+	std::vector<WorkerStats> workerStats(options.threadCount);
+
+	const auto start = std::chrono::steady_clock::now();
+	{
+		std::vector<std::jthread> workers;
+		for (unsigned int i = 0; i < options.threadCount; ++i)
+		{
+			workers.emplace_back(GenerateLevels, std::cref(options), i, std::ref(claimed), std::ref(writer), std::ref(workerStats[i]));
+		}
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	if (!writer.Finish())
+	{
+		std::cerr << "Failed writing " << options.outputPath << "\n";
+		return 1;
+	}
+
+	WorkerStats total;
+	for (const auto& stats : workerStats)
+	{
+		total.generated += stats.generated;
+		total.rejectedBalance += stats.rejectedBalance;
+		total.rejectedMoves += stats.rejectedMoves;
+	}
+
+	std::cout << std::fixed << std::setprecision(0)
+		<< std::setw(24) << "Accepted" << std::setw(14) << writer.GetBoardCount() << "\n"
+		<< std::setw(24) << "Generated" << std::setw(14) << total.generated << "\n"
+		<< std::setw(24) << "Rejected (balance)" << std::setw(14) << total.rejectedBalance << "\n"
+		<< std::setw(24) << "Rejected (valid moves)" << std::setw(14) << total.rejectedMoves << "\n"
+		<< std::setw(24) << "Boards/s" << std::setw(14) << writer.GetBoardCount() / elapsed.count() << "\n"
+		<< std::setw(24) << "File size (bytes)" << std::setw(14) << writer.GetFileSize() << "\n";
+
+	return 0;
+}
@@ -0,0 +1,13 @@
+# FranticDreamer 2025
+
+# ---
+# FranticMatch Load Generator Files
+# ---
+
+set (FRANTICMATCH_LOADGENERATOR_SOURCEDIR "FranticMatch_LoadGenerator/Source")
+
+# Source files
+file (GLOB FRANTICMATCH_LOADGENERATOR_SOURCEFILES
+
+	${FRANTICMATCH_LOADGENERATOR_SOURCEDIR}/Main.cpp
+	)
\ No newline at end of file
@@ -0,0 +1,141 @@
+// FranticDreamer 2025
+
+// This is a local load generator for the FranticMatch session host.
+// 
+// Every round, each session makes one move at the same time,
+// so the moves queue up on the host's thread pool like they would on a busy server.
+// Latency of a move is measured from submitting it to the end of its cascades.
+// 
+// Usage: FranticMatch_LoadGenerator [maxSessions] [roundCount] [threadCount]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include "FranticMatch/FranticMatch.hpp"
+
+namespace
+{
+	using Host = FranticMatch::SessionHost<int>;
+
+	/// <summary>
+	/// Latency statistics of one run.
+	/// </summary>
+	struct RunStats
+	{
+		size_t moveCount = 0;
+		double p50 = 0.0;
+		double p99 = 0.0;
+		double movesPerSecond = 0.0;
+	};
+
+	/// <summary>
+	/// Get the value at a percentile of a sorted list.
+	/// </summary>
+	double Percentile(const std::vector<double>& sorted, double percentile)
+	{
+		if (sorted.empty())
+			return 0.0;
+
+		const size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+		return sorted[index];
+	}
+
+	/// <summary>
+	/// Run every session for the given number of rounds.
+	/// </summary>
+	/// <param name="host">The host to run on.</param>
+	/// <param name="sessionCount">Number of sessions.</param>
+	/// <param name="roundCount">Number of moves every session makes.</param>
+	RunStats RunSessions(Host& host, size_t sessionCount, size_t roundCount)
+	{
+		std::vector<Host::SessionId> sessions;
+		sessions.reserve(sessionCount);
+		for (size_t i = 0; i < sessionCount; ++i)
+		{
+			sessions.push_back(host.CreateSession());
+		}
+
+		// Microseconds, filled by the workers
+		std::vector<double> latencies(sessionCount * roundCount);
+		std::atomic<size_t> latencyCount = 0;
+
+		host.SetMoveCallback([&](Host::SessionId, FranticMatch::Table<int>&, const Host::MoveResult& result)
+			{
+				latencies[latencyCount++] = std::chrono::duration<double, std::micro>(result.latency).count();
+			});
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for (size_t round = 0; round < roundCount; ++round)
+		{
+			// Tables are only read between rounds, when no move is queued
+			for (const auto id : sessions)
+			{
+				FranticMatch::MisketPosition pos1, pos2;
+				if (host.GetTable(id)->FindValidMove(pos1, pos2))
+				{
+					host.SubmitMove(id, pos1, pos2);
+				}
+			}
+
+			host.WaitIdle();
+		}
+
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		host.SetMoveCallback(nullptr);
+		for (const auto id : sessions)
+		{
+			host.DestroySession(id);
+		}
+
+		latencies.resize(latencyCount);
+		std::sort(latencies.begin(), latencies.end());
+
+		RunStats stats;
+		stats.moveCount = latencies.size();
+		stats.p50 = Percentile(latencies, 50.0);
+		stats.p99 = Percentile(latencies, 99.0);
+		stats.movesPerSecond = stats.moveCount / elapsed.count();
+		return stats;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t maxSessions = argc > 1 ? std::stoul(argv[1]) : 16384;
+	const size_t roundCount = argc > 2 ? std::stoul(argv[2]) : 20;
+	const unsigned int threadCount = argc > 3 ? std::stoul(argv[3]) : 0;
+
+	const std::vector<int> possibleValues = { 0, 1, 2, 3, 4, 5 };
+
+	Host host(8, 8, possibleValues, 3, maxSessions, threadCount);
+
+	std::cout << "FranticMatch load generator\n";
+	std::cout << "Threads: " << host.GetThreadCount() << ", rounds per run: " << roundCount << "\n\n";
+
+	std::cout << std::setw(10) << "Sessions"
+		<< std::setw(12) << "Moves"
+		<< std::setw(14) << "p50 (us)"
+		<< std::setw(14) << "p99 (us)"
+		<< std::setw(14) << "Moves/s" << "\n";
+
+	for (size_t sessionCount = 256; sessionCount <= maxSessions; sessionCount *= 2)
+	{
+		const RunStats stats = RunSessions(host, sessionCount, roundCount);
+
+		std::cout << std::fixed << std::setprecision(1)
+			<< std::setw(10) << sessionCount
+			<< std::setw(12) << stats.moveCount
+			<< std::setw(14) << stats.p50
+			<< std::setw(14) << stats.p99
+			<< std::setw(14) << std::setprecision(0) << stats.movesPerSecond << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,14 @@
+# FranticDreamer 2025
+
+# ---
+# FranticMatch Oracle Check Files
+# ---
+
+set (FRANTICMATCH_ORACLECHECK_SOURCEDIR "FranticMatch_OracleCheck/Source")
+
+# Source files
+file (GLOB FRANTICMATCH_ORACLECHECK_SOURCEFILES
+
+	${FRANTICMATCH_ORACLECHECK_SOURCEDIR}/Main.cpp
+	${FRANTICMATCH_ORACLECHECK_SOURCEDIR}/Oracle.hpp
+	)
\ No newline at end of file
@@ -0,0 +1,1475 @@
+// FranticDreamer 2025
+
+// This is a differential check of the engine kernels against the reference versions in Oracle.hpp.
+//
+// Every case makes a random board, with its own size, colour count, match rules, holes and gravity,
+// and runs it through both versions of FindMatchGroups, PopMiskets, ResolveMatchGroups and Randomise.
+// The dirty line scan, Reshuffle and move tracking are checked against the same oracle, after random edits.
+// Small boards on the torus and hex topologies, with the same rules, are checked against a walk along their lines.
+// Every board also goes through a level pack and back, a patch from Diff after random edits, and copies onto other resources.
+// Results must be identical, except for the random values, which must follow the same rules.
+// Events, refill previews and spawn weights have no reference version, their results are replayed and counted instead.
+// Both versions are timed, so a faster kernel that changes the behaviour shows up as a failure, not a speed-up.
+//
+// A failing case is printed with its seed, which reruns it alone.
+//
+// After the cases, a stream of boards is published to reader threads through a SnapshotPublisher,
+// and a SessionHost plays a move on each of its sessions.
+//
+// Usage: FranticMatch_OracleCheck [caseCount] [seed]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <utility>
+#include <filesystem>
+#include <bit>
+#include <atomic>
+#include <thread>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <cmath>
+
+#include "FranticMatch/FranticMatch.hpp"
+#include "FranticMatch/LevelPack.hpp"
+#include "Oracle.hpp"
+
+namespace
+{
+	using Table = FranticMatch::Table<int>;
+	using Board = Oracle::Board<int>;
+
+	// Up to 8 colours, see MakeCase
+	using PackedTable = FranticMatch::PackedTable<int, 3>;
+	using FranticMatch::MisketPosition;
+	using FranticMatch::SpecialMisket;
+
+	/// <summary>
+	/// Board and rules of one case.
+	/// </summary>
+	struct Case
+	{
+		unsigned int seed = 0;
+		int rowCount = 0;
+		int columnCount = 0;
+		int colourCount = 0;
+		unsigned int minMatchLength = 3;
+		Table::MatchDirections matchDirections;
+		Table::Gravity gravity = Table::Gravity::Down;
+		double holeRate = 0.0;
+	};
+
+	/// <summary>
+	/// Results of one kernel over all cases.
+	/// </summary>
+	struct KernelStats
+	{
+		const char* name;
+		size_t caseCount = 0;
+		size_t failureCount = 0;
+		double oracleMs = 0.0;
+		double engineMs = 0.0;
+	};
+
+	/// <summary>
+	/// Run a function and get its duration in milliseconds.
+	/// </summary>
+	template <typename Function>
+	double TimeMs(Function&& function)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// <summary>
+	/// Make the rules of a case from its seed.
+	/// Most boards are small, to cover the edges. Some are big, to make the timings meaningful.
+	/// </summary>
+	Case MakeCase(unsigned int seed)
+	{
+		std::mt19937 gen(seed);
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+
+		Case c;
+		c.seed = seed;
+
+		const bool isBig = roll(0, 9) == 0;
+		c.rowCount = isBig ? roll(32, 160) : roll(1, 24);
+		c.columnCount = isBig ? roll(32, 160) : roll(1, 24);
+		c.colourCount = roll(2, 8);
+		c.minMatchLength = roll(2, 5);
+
+		do
+		{
+			c.matchDirections = { roll(0, 1) == 1, roll(0, 1) == 1, roll(0, 1) == 1 };
+		} while (!c.matchDirections.horizontal && !c.matchDirections.vertical && !c.matchDirections.diagonal);
+
+		c.gravity = static_cast<Table::Gravity>(roll(0, 3));
+
+		constexpr double holeRates[] = { 0.0, 0.0, 0.05, 0.2, 0.5 };
+		c.holeRate = holeRates[roll(0, 4)];
+		return c;
+	}
+
+	/// <summary>
+	/// Describe a case for a failure report.
+	/// </summary>
+	std::string Describe(const Case& c)
+	{
+		constexpr const char* gravityNames[] = { "down", "up", "left", "right" };
+
+		std::string directions;
+		directions += c.matchDirections.horizontal ? "H" : "";
+		directions += c.matchDirections.vertical ? "V" : "";
+		directions += c.matchDirections.diagonal ? "D" : "";
+
+		return "seed " + std::to_string(c.seed)
+			+ ": " + std::to_string(c.rowCount) + "x" + std::to_string(c.columnCount)
+			+ ", " + std::to_string(c.colourCount) + " colours"
+			+ ", min " + std::to_string(c.minMatchLength)
+			+ ", " + directions
+			+ ", gravity " + gravityNames[static_cast<int>(c.gravity)]
+			+ ", holes " + std::to_string(static_cast<int>(c.holeRate * 100)) + "%";
+	}
+
+	/// <summary>
+	/// Fill a table with random miskets, special miskets and holes.
+	/// The generator is seeded by the case, so the board only depends on the seed.
+	/// </summary>
+	void FillTable(Table& table, const Case& c, const std::vector<int>& possibleValues, std::mt19937& gen)
+	{
+		std::uniform_int_distribution<size_t> colour(0, possibleValues.size() - 1);
+		std::uniform_int_distribution<int> special(1, 4);
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+		table.SetGravity(c.gravity);
+		for (int row = 0; row < c.rowCount; ++row)
+		{
+			for (int col = 0; col < c.columnCount; ++col)
+			{
+				table.Set(row, col, possibleValues[colour(gen)]);
+				table.SetSpecial(row, col, chance(gen) < 0.05 ? static_cast<SpecialMisket>(special(gen)) : SpecialMisket::None);
+				table.SetActive(row, col, chance(gen) >= c.holeRate);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Are the groups the same as the oracle's, in the same order?
+	/// </summary>
+	template <typename Groups, typename ToPosition>
+	bool SameGroups(const Groups& groups, const Oracle::MatchGroups& expected, ToPosition&& toPosition)
+	{
+		return std::ranges::equal(groups, expected, [&](const auto& group, const Oracle::MatchGroup& expectedGroup)
+			{
+				return std::ranges::equal(group, expectedGroup, [&](const auto& pos, const MisketPosition& expectedPos)
+					{
+						return toPosition(pos) == expectedPos;
+					});
+			});
+	}
+
+	/// <summary>
+	/// Groups as sorted lists of rows and columns, for comparing results that come in another order.
+	/// The cells of a group are sorted too, a group round a whole cycle has no first cell.
+	/// </summary>
+	template <typename Groups>
+	std::vector<std::vector<std::pair<int, int>>> SortedGroups(const Groups& groups)
+	{
+		std::vector<std::vector<std::pair<int, int>>> sorted;
+		for (const auto& group : groups)
+		{
+			auto& cells = sorted.emplace_back();
+			for (const auto& pos : group)
+			{
+				cells.emplace_back(pos.row, pos.column);
+			}
+			std::ranges::sort(cells);
+		}
+		std::ranges::sort(sorted);
+		return sorted;
+	}
+
+	bool IsPossibleValue(const std::vector<int>& possibleValues, int value)
+	{
+		return std::ranges::find(possibleValues, value) != possibleValues.end();
+	}
+
+	/// <summary>
+	/// Check the engine's match scans against the oracle. Each scan is timed on its own.
+	/// </summary>
+	bool CheckFindMatchGroups(const Table& table, const Case& c, KernelStats& serial, KernelStats& packed, KernelStats& lazy, KernelStats& parallel)
+	{
+		const Board board = Board::Capture(table);
+
+		Oracle::MatchGroups expected;
+		const double oracleMs = TimeMs([&] { expected = Oracle::FindMatchGroups(board, c.minMatchLength, c.matchDirections); });
+
+		FranticMatch::MisketMatchGroups groups;
+		serial.engineMs += TimeMs([&] { groups = table.FindMatchGroups(c.minMatchLength, c.matchDirections); });
+		serial.oracleMs += oracleMs;
+		const bool serialOk = SameGroups(groups, expected, [](const MisketPosition& pos) { return pos; });
+
+		FranticMatch::PackedMisketMatchGroups<> packedGroups;
+		packed.engineMs += TimeMs([&] { packedGroups = table.FindPackedMatchGroups(c.minMatchLength, c.matchDirections); });
+		packed.oracleMs += oracleMs;
+		const bool packedOk = SameGroups(packedGroups, expected, [&](FranticMatch::PackedMisketPosition pos) { return table.Unpack(pos); });
+
+		// Lazy groups are views, copied out before the next one is scanned
+		Oracle::MatchGroups lazyGroups;
+		bool hasAnyMatch = false;
+		lazy.engineMs += TimeMs([&]
+			{
+				for (const auto group : table.EnumerateMatchGroups(c.minMatchLength, c.matchDirections))
+				{
+					lazyGroups.emplace_back(group.begin(), group.end());
+				}
+				hasAnyMatch = table.HasAnyMatch(c.minMatchLength, c.matchDirections);
+			});
+		lazy.oracleMs += oracleMs;
+		const bool lazyOk = lazyGroups == expected && hasAnyMatch == !expected.empty();
+
+		// The parallel scan only promises the same groups, diagonal ones may come in another order
+		FranticMatch::MisketMatchGroups parallelGroups;
+		parallel.engineMs += TimeMs([&] { parallelGroups = table.FindMatchGroupsParallel(c.minMatchLength, c.matchDirections, 4); });
+		parallel.oracleMs += oracleMs;
+		const bool parallelOk = SortedGroups(parallelGroups) == SortedGroups(expected);
+
+		++serial.caseCount;
+		++packed.caseCount;
+		++lazy.caseCount;
+		++parallel.caseCount;
+		serial.failureCount += !serialOk;
+		packed.failureCount += !packedOk;
+		lazy.failureCount += !lazyOk;
+		parallel.failureCount += !parallelOk;
+
+		return serialOk && packedOk && lazyOk && parallelOk;
+	}
+
+	/// <summary>
+	/// Check the parallel scan on a board big enough to be split into bands, with the rules of a case.
+	/// The runs crossing band borders must be found whole, exactly once.
+	/// It has its own generator, so the rest of the case is the same with or without it.
+	/// </summary>
+	bool CheckParallelBands(const Case& c, const std::vector<int>& possibleValues, KernelStats& stats)
+	{
+		std::mt19937 gen(~c.seed);
+
+		Case big = c;
+		big.rowCount = 256;
+		big.columnCount = std::uniform_int_distribution<int>(128, 256)(gen);
+
+		Table table(big.rowCount, big.columnCount, possibleValues);
+		FillTable(table, big, possibleValues, gen);
+		const Board board = Board::Capture(table);
+
+		Oracle::MatchGroups expected;
+		stats.oracleMs += TimeMs([&] { expected = Oracle::FindMatchGroups(board, big.minMatchLength, big.matchDirections); });
+
+		FranticMatch::MisketMatchGroups groups;
+		stats.engineMs += TimeMs([&] { groups = table.FindMatchGroupsParallel(big.minMatchLength, big.matchDirections, 4); });
+		const bool ok = SortedGroups(groups) == SortedGroups(expected);
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Check a small table on another topology against a walk along its lines, with the rules of a case:
+	/// the match scans, which cells are neighbours, and the valid move count, with and without move tracking.
+	/// A run is planted over the seams of a row and a column, where a wrapping topology joins its edges.
+	/// </summary>
+	template <typename Topology>
+	bool CheckTopology(const Case& c, const std::vector<int>& possibleValues, std::mt19937& gen, KernelStats& matchStats, KernelStats& moveStats)
+	{
+		using TopologyTable = FranticMatch::Table<int, FranticMatch::Scalar, std::identity, FranticMatch::NoPayload, Topology>;
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+		const int rowCount = roll(3, 10);
+		const int columnCount = roll(3, 10);
+		const typename TopologyTable::MatchDirections matchDirections { c.matchDirections.horizontal, c.matchDirections.vertical, c.matchDirections.diagonal };
+
+		TopologyTable table(rowCount, columnCount, possibleValues);
+		for (int row = 0; row < rowCount; ++row)
+		{
+			for (int col = 0; col < columnCount; ++col)
+			{
+				table.Set(row, col, possibleValues[roll(0, static_cast<int>(possibleValues.size()) - 1)]);
+				table.SetActive(row, col, chance(gen) >= c.holeRate);
+			}
+		}
+
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			int row = axis == 0 ? roll(0, rowCount - 1) : 0;
+			int col = axis == 0 ? 0 : roll(0, columnCount - 1);
+			if (!Topology::Step(rowCount, columnCount, row, col, axis, false))
+				continue;
+
+			const int value = possibleValues[roll(0, static_cast<int>(possibleValues.size()) - 1)];
+			for (unsigned int k = 0; k < c.minMatchLength; ++k, Topology::Step(rowCount, columnCount, row, col, axis, true))
+			{
+				table.Set(row, col, value);
+				table.SetActive(row, col, true);
+			}
+		}
+
+		const Board board = Board::Capture(table);
+
+		Oracle::MatchGroups expected;
+		matchStats.oracleMs += TimeMs([&] { expected = Oracle::FindLineMatchGroups<Topology>(board, c.minMatchLength, matchDirections); });
+
+		FranticMatch::MisketMatchGroups groups;
+		matchStats.engineMs += TimeMs([&] { groups = table.FindMatchGroups(c.minMatchLength, matchDirections); });
+
+		Oracle::MatchGroups lazyGroups;
+		for (const auto group : table.EnumerateMatchGroups(c.minMatchLength, matchDirections))
+		{
+			lazyGroups.emplace_back(group.begin(), group.end());
+		}
+
+		const auto sortedExpected = SortedGroups(expected);
+		const bool matchesOk = SortedGroups(groups) == sortedExpected
+			&& SortedGroups(lazyGroups) == sortedExpected
+			&& SortedGroups(table.FindMatchGroupsParallel(c.minMatchLength, matchDirections, 4)) == sortedExpected
+			&& table.HasAnyMatch(c.minMatchLength, matchDirections) == !expected.empty();
+
+		bool movesOk = true;
+		const int cellCount = rowCount * columnCount;
+		for (int index = 0; movesOk && index < cellCount; ++index)
+		{
+			for (int other = 0; movesOk && other < cellCount; ++other)
+			{
+				movesOk = table.IsAdjacent(index / columnCount, index % columnCount, other / columnCount, other % columnCount, matchDirections)
+					== Oracle::AreNeighbours<Topology>(board, index, other, matchDirections);
+			}
+		}
+
+		int expectedMoves = 0;
+		int moves = 0;
+		moveStats.oracleMs += TimeMs([&] { expectedMoves = Oracle::CountValidMoves<Topology>(board, c.minMatchLength, matchDirections); });
+		moveStats.engineMs += TimeMs([&] { moves = table.GetValidMoveCount(c.minMatchLength, matchDirections); });
+
+		TopologyTable tracked = table;
+		tracked.EnableMoveTracking(c.minMatchLength, matchDirections);
+		movesOk = movesOk && moves == expectedMoves
+			&& tracked.GetValidMoveCount(c.minMatchLength, matchDirections) == expectedMoves
+			&& table.HasAnyValidMove(c.minMatchLength, matchDirections) == (expectedMoves > 0);
+
+		++matchStats.caseCount;
+		++moveStats.caseCount;
+		matchStats.failureCount += !matchesOk;
+		moveStats.failureCount += !movesOk;
+		return matchesOk && movesOk;
+	}
+
+	/// <summary>
+	/// Check the match scan of a packed copy of the table against the oracle.
+	/// </summary>
+	bool CheckPackedTable(const Table& table, const Case& c, const std::vector<int>& possibleValues, KernelStats& stats)
+	{
+		const Board board = Board::Capture(table);
+
+		Oracle::MatchGroups expected;
+		stats.oracleMs += TimeMs([&] { expected = Oracle::FindMatchGroups(board, c.minMatchLength, c.matchDirections); });
+
+		PackedTable packedTable(0, 0, possibleValues);
+		bool ok = packedTable.Pack(table);
+
+		FranticMatch::MisketMatchGroups groups;
+		stats.engineMs += TimeMs([&] { groups = packedTable.FindMatchGroups(c.minMatchLength, c.matchDirections); });
+		ok = ok && SameGroups(groups, expected, [](const MisketPosition& pos) { return pos; });
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Is a collapse the same as the oracle's? Spawned miskets are random, so they only have to be in the right cells, with possible values.
+	/// The collapse moves must turn the board before into the board after: the falls in order, then the spawns, on exactly the oracle's cells.
+	/// </summary>
+	bool IsCollapsed(const Board& before, const Board& after, const Board& expected, const std::vector<bool>& spawned,
+		const Table::CollapseMoves& collapseMoves, const std::vector<int>& possibleValues)
+	{
+		bool ok = after.active == before.active;
+
+		for (size_t index = 0; ok && index < after.values.size(); ++index)
+		{
+			if (spawned[index])
+			{
+				ok = IsPossibleValue(possibleValues, after.values[index]) && after.specials[index] == SpecialMisket::None;
+			}
+			else
+			{
+				ok = after.values[index] == expected.values[index] && after.specials[index] == expected.specials[index];
+			}
+		}
+
+		std::vector<int> replayed = before.values;
+		for (const auto& fall : collapseMoves.falls)
+		{
+			ok = ok && fall.from.index < replayed.size() && fall.to.index < replayed.size();
+			if (ok)
+				replayed[fall.to.index] = replayed[fall.from.index];
+		}
+
+		std::vector<bool> reported(after.values.size(), false);
+		for (const auto& spawn : collapseMoves.spawns)
+		{
+			ok = ok && spawn.to.index < reported.size() && !reported[spawn.to.index];
+			if (ok)
+			{
+				reported[spawn.to.index] = true;
+				replayed[spawn.to.index] = spawn.value;
+			}
+		}
+
+		for (size_t index = 0; ok && index < after.values.size(); ++index)
+		{
+			ok = !after.active[index] || replayed[index] == after.values[index];
+		}
+
+		return ok && reported == spawned;
+	}
+
+	/// <summary>
+	/// Pop random miskets, with a few duplicates and positions out of bounds,
+	/// and check the engine's collapse and its fall list against the oracle.
+	/// </summary>
+	bool CheckPopMiskets(Table& table, const Case& c, const std::vector<int>& possibleValues, std::mt19937& gen, KernelStats& stats)
+	{
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+		const double popRate = chance(gen) * 0.5;
+
+		std::vector<MisketPosition> positions;
+		for (int row = 0; row < c.rowCount; ++row)
+		{
+			for (int col = 0; col < c.columnCount; ++col)
+			{
+				if (chance(gen) < popRate)
+					positions.push_back(MisketPosition(row, col));
+			}
+		}
+		if (!positions.empty())
+			positions.push_back(positions.front());
+		positions.push_back(MisketPosition(-1, 0));
+		positions.push_back(MisketPosition(c.rowCount, c.columnCount - 1));
+		std::ranges::shuffle(positions, gen);
+
+		const Board before = Board::Capture(table);
+		Board expected = before;
+
+		std::vector<bool> spawned;
+		stats.oracleMs += TimeMs([&] { spawned = Oracle::PopMiskets(expected, positions); });
+
+		Table::CollapseMoves collapseMoves;
+		stats.engineMs += TimeMs([&] { table.PopMiskets(std::span<const MisketPosition>(positions), &collapseMoves); });
+
+		const bool ok = IsCollapsed(before, Board::Capture(table), expected, spawned, collapseMoves, possibleValues);
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Randomise with the engine and the oracle, and check both boards follow the rules:
+	/// possible values on the active cells, no special miskets, no matches and untouched holes.
+	/// </summary>
+	bool CheckRandomise(Table& table, unsigned int minMatchLength, const std::vector<int>& possibleValues, std::mt19937& gen, KernelStats& stats)
+	{
+		const Board before = Board::Capture(table);
+
+		Board oracleBoard = before;
+		stats.oracleMs += TimeMs([&] { Oracle::Randomise(oracleBoard, possibleValues, minMatchLength, gen); });
+		stats.engineMs += TimeMs([&] { table.Randomise(); });
+
+		auto followsRules = [&](const Board& board)
+		{
+			for (size_t index = 0; index < board.values.size(); ++index)
+			{
+				if (board.specials[index] != SpecialMisket::None || board.active[index] != before.active[index])
+					return false;
+
+				if (board.active[index] ? !IsPossibleValue(possibleValues, board.values[index]) : board.values[index] != before.values[index])
+					return false;
+			}
+
+			return Oracle::FindMatchGroups(board, minMatchLength, {}).empty();
+		};
+
+		const bool ok = followsRules(Board::Capture(table)) && followsRules(oracleBoard);
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Write the table and a copy with other holes to a level pack, with the case's rules and with other match directions, and load them back.
+	/// Sizes, possible values, minimum match lengths, match directions, holes and active miskets must survive. Specials aren't stored.
+	/// The first run of levels carries on across two writes, and the last level goes back to the first rules.
+	/// </summary>
+	bool CheckLevelPack(const Table& table, const Case& c, std::mt19937& gen, const std::string& path, KernelStats& stats)
+	{
+		using PackWriter = FranticMatch::LevelPackWriter<int>;
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+		Table holed = table;
+		for (int row = 0; row < c.rowCount; ++row)
+		{
+			for (int col = 0; col < c.columnCount; ++col)
+			{
+				if (chance(gen) < 0.2)
+					holed.SetActive(row, col, !holed.IsActive(row, col));
+			}
+		}
+
+		Table::MatchDirections otherDirections = c.matchDirections;
+		otherDirections.diagonal = !otherDirections.diagonal;
+
+		const std::pair<const Table*, Table::MatchDirections> levels[] = {
+			{ &table, c.matchDirections }, { &holed, c.matchDirections },
+			{ &table, c.matchDirections }, { &holed, otherDirections }, { &table, c.matchDirections } };
+
+		PackWriter writer;
+		std::vector<std::uint8_t> records;
+		std::vector<FranticMatch::LevelPackEntry> entries;
+		bool ok = writer.Open(path);
+		for (size_t level = 0; level < std::size(levels); ++level)
+		{
+			ok = PackWriter::EncodeLevel(*levels[level].first, levels[level].second, records, entries) && ok;
+			if (level == 1 || level + 1 == std::size(levels))
+			{
+				ok = writer.Write(records, entries) && ok;
+				records.clear();
+				entries.clear();
+			}
+		}
+		ok = writer.Finish() && ok;
+
+		// Levels are only their cells, the two rules and three runs are stored once each
+		auto alignedSize = [](size_t size) { return (size + 7) / 8 * 8; };
+		const size_t bitsPerCell = std::bit_width(table.GetPossibleValues().size());
+		const size_t cellBytes = (static_cast<size_t>(c.rowCount) * c.columnCount * bitsPerCell + 7) / 8;
+		ok = ok && writer.GetSize() == alignedSize(FranticMatch::LevelPackFormat::headerSize + std::size(levels) * cellBytes)
+			+ 2 * alignedSize(FranticMatch::LevelPackFormat::rulesHeaderSize + table.GetPossibleValues().size() * sizeof(int))
+			+ 3 * FranticMatch::LevelPackFormat::entrySize;
+
+		FranticMatch::LevelPack<int> pack;
+		ok = ok && pack.Open(path) && pack.GetLevelCount() == std::size(levels);
+
+		for (size_t level = 0; ok && level < std::size(levels); ++level)
+		{
+			const Table& expected = *levels[level].first;
+			const Table::MatchDirections expectedDirections = levels[level].second;
+
+			Table loaded;
+			Table::MatchDirections matchDirections;
+			stats.engineMs += TimeMs([&] { ok = pack.LoadLevel(level, loaded, matchDirections); });
+
+			const Board expectedBoard = Board::Capture(expected);
+			const Board loadedBoard = Board::Capture(loaded);
+			ok = ok && loadedBoard.rowCount == expectedBoard.rowCount && loadedBoard.columnCount == expectedBoard.columnCount
+				&& std::ranges::equal(loaded.GetPossibleValues(), expected.GetPossibleValues())
+				&& loaded.GetMinimumMatchLength() == expected.GetMinimumMatchLength()
+				&& matchDirections.horizontal == expectedDirections.horizontal
+				&& matchDirections.vertical == expectedDirections.vertical
+				&& matchDirections.diagonal == expectedDirections.diagonal
+				&& loadedBoard.active == expectedBoard.active;
+
+			for (size_t index = 0; ok && index < expectedBoard.values.size(); ++index)
+			{
+				ok = !expectedBoard.active[index] || loadedBoard.values[index] == expectedBoard.values[index];
+			}
+
+			// Loading into a table that has a board already must move it to the given resource
+			std::pmr::unsynchronized_pool_resource levelResource;
+			ok = ok && pack.LoadLevel(level, loaded, matchDirections, &levelResource) && loaded.GetMemoryResource() == &levelResource
+				&& Board::Capture(loaded).values == loadedBoard.values;
+		}
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Make random edits and holes on a copy of the table, and check Diff against a cell by cell compare.
+	/// The patch must turn the table, with or without move tracking, and a board of another size into the edited copy.
+	/// </summary>
+	bool CheckDiff(const Table& table, const Case& c, const std::vector<int>& possibleValues, std::mt19937& gen, KernelStats& stats)
+	{
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+
+		// A few edits, or up to one per cell
+		Table edited = table;
+		const int editCount = roll(0, roll(0, 1) == 0 ? 8 : c.rowCount * c.columnCount);
+		for (int edit = 0; edit < editCount; ++edit)
+		{
+			const int row = roll(0, c.rowCount - 1);
+			const int col = roll(0, c.columnCount - 1);
+			switch (roll(0, 2))
+			{
+			case 0:
+				edited.Set(row, col, possibleValues[roll(0, static_cast<int>(possibleValues.size()) - 1)]);
+				break;
+			case 1:
+				edited.SetSpecial(row, col, static_cast<SpecialMisket>(roll(0, 4)));
+				break;
+			default:
+				edited.SetActive(row, col, roll(0, 1) == 1);
+				break;
+			}
+		}
+
+		const Board before = Board::Capture(table);
+		const Board after = Board::Capture(edited);
+
+		std::vector<int> expected;
+		stats.oracleMs += TimeMs([&]
+			{
+				for (size_t index = 0; index < after.values.size(); ++index)
+				{
+					if (after.values[index] != before.values[index] || after.specials[index] != before.specials[index] || after.active[index] != before.active[index])
+						expected.push_back(static_cast<int>(index));
+				}
+			});
+
+		Table::BoardPatch patch;
+		stats.engineMs += TimeMs([&] { patch = edited.Diff(table); });
+		bool ok = std::ranges::equal(patch.indices, expected);
+
+		// Gravity isn't part of a patch
+		auto isEdited = [&](const Table& patched)
+		{
+			const Board board = Board::Capture(patched);
+			return board.rowCount == after.rowCount && board.columnCount == after.columnCount
+				&& board.values == after.values && board.specials == after.specials && board.active == after.active;
+		};
+
+		Table patched = table;
+		patched.ApplyPatch(patch);
+		ok = ok && isEdited(patched);
+
+		// Counting valid moves is slow on the big boards, so only small ones are patched with move tracking
+		if (c.rowCount * c.columnCount <= 24 * 24)
+		{
+			Table tracked = table;
+			tracked.EnableMoveTracking(c.minMatchLength, c.matchDirections);
+
+			// The set is built on the first count, so the patch has to mark the cells it changes
+			tracked.GetValidMoveCount(c.minMatchLength, c.matchDirections);
+			tracked.ApplyPatch(patch);
+			ok = ok && isEdited(tracked)
+				&& tracked.GetValidMoveCount(c.minMatchLength, c.matchDirections) == edited.GetValidMoveCount(c.minMatchLength, c.matchDirections);
+		}
+
+		// Every cell is in a patch against another size, and the board is resized to the edited one's
+		Table resized(c.rowCount + 1, c.columnCount, possibleValues);
+		resized.ApplyPatch(edited.Diff(resized));
+		ok = ok && isEdited(resized);
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Resolve the board's matches in one step, with a moved misket now and then,
+	/// and check the special miskets made, the chains they set off and the collapse against the oracle.
+	/// </summary>
+	bool CheckResolveMatchGroups(const Table& table, const Case& c, const std::vector<int>& possibleValues, std::mt19937& gen, KernelStats& stats)
+	{
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+
+		Table resolved = table;
+		const FranticMatch::MisketMatchGroups groups = resolved.FindMatchGroups(c.minMatchLength, c.matchDirections);
+
+		std::vector<MisketPosition> moved;
+		if (!groups.empty() && roll(0, 1) == 1)
+		{
+			const auto& group = groups[roll(0, static_cast<int>(groups.size()) - 1)];
+			moved.push_back(group[roll(0, static_cast<int>(group.size()) - 1)]);
+		}
+
+		Oracle::MatchGroups expectedGroups;
+		for (const auto& group : groups)
+		{
+			expectedGroups.emplace_back(group.begin(), group.end());
+		}
+
+		const Board before = Board::Capture(resolved);
+		Board expected = before;
+
+		Oracle::ClearResult expectedResult;
+		stats.oracleMs += TimeMs([&] { expectedResult = Oracle::ResolveMatchGroups(expected, expectedGroups, moved); });
+
+		Table::CollapseMoves collapseMoves;
+		FranticMatch::ClearResult result;
+		stats.engineMs += TimeMs([&] { result = resolved.ResolveMatchGroups(std::span<const FranticMatch::MisketMatchGroup>(groups), moved, &collapseMoves); });
+
+		const bool ok = std::ranges::equal(result.cleared, expectedResult.cleared)
+			&& std::ranges::equal(result.created, expectedResult.created)
+			&& static_cast<size_t>(result.triggeredCount) == expectedResult.triggeredCount
+			&& IsCollapsed(before, Board::Capture(resolved), expected, expectedResult.spawned, collapseMoves, possibleValues);
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Play a move, its cascade and a pop with an event observer, and replay the events on a copy of the board.
+	/// The copy must end up like the table, and every matched and cleared misket must have its event.
+	/// </summary>
+	bool CheckEvents(const Table& table, const Case& c, std::mt19937& gen, KernelStats& stats)
+	{
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+
+		Table played = table;
+		Board mirror = Board::Capture(played);
+		size_t matchedCount = 0;
+		size_t clearedCount = 0;
+
+		// Spawned events don't carry the value, the table has it after the operation
+		played.SetEventObserver([&](std::span<const FranticMatch::BoardEvent> events)
+			{
+				for (const auto& event : events)
+				{
+					const int from = mirror.Index(event.from.row, event.from.column);
+					const int to = mirror.Index(event.to.row, event.to.column);
+					switch (event.type)
+					{
+					case FranticMatch::BoardEventType::Swapped:
+						std::swap(mirror.values[from], mirror.values[to]);
+						break;
+					case FranticMatch::BoardEventType::Matched:
+						++matchedCount;
+						break;
+					case FranticMatch::BoardEventType::Cleared:
+						++clearedCount;
+						break;
+					case FranticMatch::BoardEventType::Moved:
+						mirror.values[to] = mirror.values[from];
+						break;
+					case FranticMatch::BoardEventType::Spawned:
+						mirror.values[to] = played.Get(event.to.row, event.to.column);
+						break;
+					}
+				}
+			});
+
+		MisketPosition first(roll(0, c.rowCount - 1), roll(0, c.columnCount - 1));
+		MisketPosition second(first.row, std::min(first.column + 1, c.columnCount - 1));
+		played.FindValidMove(first, second, c.minMatchLength, c.matchDirections);
+
+		size_t expectedMatchedCount = 0;
+		size_t expectedClearedCount = 0;
+		stats.engineMs += TimeMs([&]
+			{
+				FranticMatch::MisketMatchGroups groups = played.SwapAndGetMatches(first, second, c.minMatchLength, c.matchDirections);
+				for (const auto& group : groups)
+				{
+					expectedMatchedCount += group.size();
+				}
+
+				// Two colour boards can cascade for a long time
+				const MisketPosition movedPositions[] = { first, second };
+				std::span<const MisketPosition> moved = movedPositions;
+				for (int step = 0; step < 2 && !groups.empty(); ++step)
+				{
+					expectedClearedCount += played.ResolveMatchGroups(groups, moved).cleared.size();
+					groups = played.FindMatchGroups(c.minMatchLength, c.matchDirections);
+					moved = {};
+				}
+
+				const MisketPosition popped[] = { MisketPosition(roll(0, c.rowCount - 1), roll(0, c.columnCount - 1)) };
+				played.PopMiskets(std::span<const MisketPosition>(popped));
+				expectedClearedCount += played.IsActive(popped[0]);
+			});
+
+		const Board after = Board::Capture(played);
+		bool ok = matchedCount == expectedMatchedCount && clearedCount == expectedClearedCount;
+		for (size_t index = 0; ok && index < after.values.size(); ++index)
+		{
+			ok = !after.active[index] || mirror.values[index] == after.values[index];
+		}
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Preview a whole lane of refills on every lane, pop random miskets, and check the spawns of every lane are its preview, in order.
+	/// A few rounds run through the end of the queues, so they are filled up again on the way.
+	/// </summary>
+	bool CheckRefills(const Table& table, const Case& c, std::mt19937& gen, KernelStats& stats)
+	{
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+		Table refilled = table;
+		const bool isVertical = c.gravity == Table::Gravity::Down || c.gravity == Table::Gravity::Up;
+		const int laneCount = isVertical ? c.columnCount : c.rowCount;
+		const int laneLength = isVertical ? c.rowCount : c.columnCount;
+
+		bool ok = true;
+		for (int round = 0; ok && round < 3; ++round)
+		{
+			// A preview is only valid until the table changes, so they are copied
+			std::vector<std::vector<int>> previews;
+			for (int lane = 0; lane < laneCount; ++lane)
+			{
+				const std::span<const int> preview = refilled.PreviewRefills(lane, laneLength);
+				ok = ok && preview.size() == static_cast<size_t>(laneLength);
+				previews.emplace_back(preview.begin(), preview.end());
+			}
+
+			const double popRate = chance(gen);
+			std::vector<MisketPosition> positions;
+			for (int row = 0; row < c.rowCount; ++row)
+			{
+				for (int col = 0; col < c.columnCount; ++col)
+				{
+					if (chance(gen) < popRate)
+						positions.push_back(MisketPosition(row, col));
+				}
+			}
+
+			Table::CollapseMoves collapseMoves;
+			stats.engineMs += TimeMs([&] { refilled.PopMiskets(std::span<const MisketPosition>(positions), &collapseMoves); });
+
+			std::vector<size_t> spawnCounts(laneCount, 0);
+			for (const auto& spawn : collapseMoves.spawns)
+			{
+				const MisketPosition pos = refilled.Unpack(spawn.to);
+				const int lane = isVertical ? pos.column : pos.row;
+				ok = ok && spawnCounts[lane] < previews[lane].size() && spawn.value == previews[lane][spawnCounts[lane]++];
+			}
+		}
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Set random spawn weights, one of them zero, and check invalid weights are refused,
+	/// the zero weighted value never spawns, and a long run of draws follows the weights.
+	/// </summary>
+	bool CheckSpawnWeights(const Table& table, const Case& c, const std::vector<int>& possibleValues, std::mt19937& gen, KernelStats& stats)
+	{
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+
+		// Draws are checked against a tolerance, so they are repeatable from the seed
+		Table::SeedRandom(c.seed);
+
+		const int valueCount = static_cast<int>(possibleValues.size());
+		std::vector<double> weights(valueCount);
+		for (double& weight : weights)
+		{
+			weight = roll(0, 4);
+		}
+
+		const int zeroIndex = roll(0, valueCount - 1);
+		weights[zeroIndex] = 0.0;
+		weights[(zeroIndex + 1) % valueCount] += 1.0;
+
+		Table weighted = table;
+		bool ok = !weighted.SetSpawnWeights(std::vector<double>(valueCount + 1, 1.0))
+			&& !weighted.SetSpawnWeights(std::vector<double>(valueCount, 0.0))
+			&& weighted.SetSpawnWeights(weights)
+			&& std::ranges::equal(weighted.GetSpawnWeights(), weights);
+
+		// Refills drawn before the weights keep their values
+		weighted.ClearRefillQueues();
+
+		std::vector<MisketPosition> positions;
+		for (int row = 0; row < c.rowCount; ++row)
+		{
+			for (int col = 0; col < c.columnCount; ++col)
+			{
+				positions.push_back(MisketPosition(row, col));
+			}
+		}
+
+		Table::CollapseMoves collapseMoves;
+		weighted.PopMiskets(std::span<const MisketPosition>(positions), &collapseMoves);
+		for (const auto& spawn : collapseMoves.spawns)
+		{
+			ok = ok && spawn.value != possibleValues[zeroIndex];
+		}
+
+		constexpr size_t drawCount = 20000;
+		std::vector<int> miskets(drawCount);
+		stats.engineMs += TimeMs([&] { weighted.GenerateRandomMiskets(miskets); });
+
+		const double totalWeight = std::accumulate(weights.begin(), weights.end(), 0.0);
+		for (int value = 0; ok && value < valueCount; ++value)
+		{
+			const double share = static_cast<double>(std::ranges::count(miskets, possibleValues[value])) / drawCount;
+			ok = weights[value] == 0.0 ? share == 0.0 : std::abs(share - weights[value] / totalWeight) < 0.02;
+		}
+
+		ok = ok && weighted.SetSpawnWeights({}) && weighted.GetSpawnWeights().empty();
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Scan only the dirty lines after random edits, and check the groups against a full scan of the oracle, in the same order.
+	/// The groups of every scan are popped before the next edit, as the scan expects.
+	/// </summary>
+	bool CheckDirtyMatchGroups(const Table& table, const Case& c, const std::vector<int>& possibleValues, std::mt19937& gen, KernelStats& stats)
+	{
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+
+		Table dirty = table;
+		bool ok = true;
+		for (int step = 0; ok && step < 6; ++step)
+		{
+			const Board board = Board::Capture(dirty);
+
+			Oracle::MatchGroups expected;
+			stats.oracleMs += TimeMs([&] { expected = Oracle::FindMatchGroups(board, c.minMatchLength, c.matchDirections); });
+
+			FranticMatch::MisketMatchGroups groups;
+			stats.engineMs += TimeMs([&] { groups = dirty.FindDirtyMatchGroups(c.minMatchLength, c.matchDirections); });
+			ok = SameGroups(groups, expected, [](const MisketPosition& pos) { return pos; });
+
+			dirty.PopMisketMatchGroups(std::span<const FranticMatch::MisketMatchGroup>(groups));
+
+			const int row = roll(0, c.rowCount - 1);
+			const int col = roll(0, c.columnCount - 1);
+			switch (roll(0, 3))
+			{
+			case 0:
+				dirty.Set(row, col, possibleValues[roll(0, static_cast<int>(possibleValues.size()) - 1)]);
+				break;
+			case 1:
+				dirty.Swap(row, col, std::min(row + roll(0, 1), c.rowCount - 1), std::min(col + roll(0, 1), c.columnCount - 1));
+				break;
+			case 2:
+				dirty.SetActive(row, col, !dirty.IsActive(row, col));
+				break;
+			default:
+			{
+				const MisketPosition popped[] = { MisketPosition(row, col) };
+				dirty.PopMiskets(std::span<const MisketPosition>(popped));
+				break;
+			}
+			}
+		}
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Reshuffle with the rules of a case. A rebuilt board must have no matches and a valid move by the oracle,
+	/// with possible values, no special miskets and untouched holes. A board that can't be rebuilt must be left as it was.
+	/// </summary>
+	bool CheckReshuffle(const Table& table, const Case& c, const std::vector<int>& possibleValues, KernelStats& stats)
+	{
+		Table reshuffled = table;
+		const Board before = Board::Capture(reshuffled);
+
+		bool isRebuilt = false;
+		stats.engineMs += TimeMs([&] { isRebuilt = reshuffled.Reshuffle(c.minMatchLength, c.matchDirections); });
+
+		const Board after = Board::Capture(reshuffled);
+		bool ok = after.active == before.active;
+		if (!isRebuilt)
+		{
+			ok = ok && after.values == before.values && after.specials == before.specials;
+		}
+		else
+		{
+			for (size_t index = 0; ok && index < after.values.size(); ++index)
+			{
+				ok = after.specials[index] == SpecialMisket::None
+					&& (after.active[index] ? IsPossibleValue(possibleValues, after.values[index]) : after.values[index] == before.values[index]);
+			}
+
+			// Counting valid moves is slow on the big boards, they only get the engine's answer
+			bool hasValidMove = false;
+			stats.oracleMs += TimeMs([&]
+				{
+					ok = ok && Oracle::FindMatchGroups(after, c.minMatchLength, c.matchDirections).empty();
+					if (c.rowCount * c.columnCount <= 12 * 12)
+						hasValidMove = Oracle::CountValidMoves<FranticMatch::SquareTopology>(after, c.minMatchLength, c.matchDirections) > 0;
+					else
+						hasValidMove = reshuffled.HasAnyValidMove(c.minMatchLength, c.matchDirections);
+				});
+			ok = ok && hasValidMove;
+		}
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Keep a small table's valid moves tracked through swaps, pops and cascade steps,
+	/// and check the count after every change against the oracle's count.
+	/// </summary>
+	bool CheckMoveTracking(const Table& table, const Case& c, std::mt19937& gen, KernelStats& stats)
+	{
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+
+		Table tracked = table;
+		tracked.EnableMoveTracking(c.minMatchLength, c.matchDirections);
+
+		bool ok = true;
+		for (int step = 0; ok && step < 4; ++step)
+		{
+			const Board board = Board::Capture(tracked);
+
+			int expected = 0;
+			int count = 0;
+			stats.oracleMs += TimeMs([&] { expected = Oracle::CountValidMoves<FranticMatch::SquareTopology>(board, c.minMatchLength, c.matchDirections); });
+			stats.engineMs += TimeMs([&] { count = tracked.GetValidMoveCount(c.minMatchLength, c.matchDirections); });
+			ok = count == expected;
+
+			const int row = roll(0, c.rowCount - 1);
+			const int col = roll(0, c.columnCount - 1);
+			switch (roll(0, 2))
+			{
+			case 0:
+				tracked.Swap(row, col, std::min(row + roll(0, 1), c.rowCount - 1), std::min(col + roll(0, 1), c.columnCount - 1));
+				break;
+			case 1:
+			{
+				const MisketPosition popped[] = { MisketPosition(row, col), MisketPosition(roll(0, c.rowCount - 1), col) };
+				tracked.PopMiskets(std::span<const MisketPosition>(popped));
+				break;
+			}
+			default:
+				tracked.ResolveMatchGroups(tracked.FindMatchGroups(c.minMatchLength, c.matchDirections));
+				break;
+			}
+		}
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Memory resource that counts its allocations, and gets them from another one.
+	/// </summary>
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		explicit CountingResource(std::pmr::memory_resource* upstream)
+			: upstream(upstream)
+		{
+		}
+
+		size_t allocationCount = 0;
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			++allocationCount;
+			return upstream->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override
+		{
+			upstream->deallocate(pointer, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+		std::pmr::memory_resource* upstream;
+	};
+
+	/// <summary>
+	/// Copy a tracked table onto an arena, and with the plain copy. Both copies must play like the original,
+	/// the arena copy must not touch the default resource, and neither may keep the original's scratch resource.
+	/// </summary>
+	bool CheckCopy(const Table& table, const Case& c, KernelStats& stats)
+	{
+		std::pmr::unsynchronized_pool_resource scratch;
+		Table original = table;
+		original.SetScratchResource(&scratch);
+		original.EnableMoveTracking(c.minMatchLength, c.matchDirections);
+		const auto validMoveCount = original.GetValidMoveCount(c.minMatchLength, c.matchDirections);
+
+		CountingResource defaultResource(std::pmr::get_default_resource());
+		std::pmr::monotonic_buffer_resource arena;
+
+		std::pmr::memory_resource* previousDefault = std::pmr::set_default_resource(&defaultResource);
+		Table onArena(original, &arena);
+		std::pmr::set_default_resource(previousDefault);
+
+		const Table plain = original;
+		const Board board = Board::Capture(original);
+
+		bool ok = defaultResource.allocationCount == 0;
+		for (const Table* copy : { static_cast<const Table*>(&onArena), &plain })
+		{
+			ok = ok && copy->GetScratchResource() != &scratch
+				&& Board::Capture(*copy).values == board.values && Board::Capture(*copy).active == board.active
+				&& copy->GetValidMoveCount(c.minMatchLength, c.matchDirections) == validMoveCount
+				&& SortedGroups(copy->FindMatchGroups(c.minMatchLength, c.matchDirections)) == SortedGroups(original.FindMatchGroups(c.minMatchLength, c.matchDirections));
+		}
+		ok = ok && onArena.GetMemoryResource() == &arena && plain.GetMemoryResource() == std::pmr::get_default_resource();
+
+		++stats.caseCount;
+		stats.failureCount += !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Publish a stream of boards while reader threads acquire them.
+	/// Every board is made from the number of its publish, so a reader can check it holds one whole board,
+	/// with the epoch of that publish, and never one older than the board it held before.
+	/// </summary>
+	bool CheckSnapshotPublisher(unsigned int seed, KernelStats& stats)
+	{
+		constexpr int publishCount = 20000;
+		constexpr int readerCount = 2;
+
+		std::mt19937 gen(seed);
+		auto roll = [&](int min, int max) { return std::uniform_int_distribution<int>(min, max)(gen); };
+		const int rowCount = roll(1, 16);
+		const int columnCount = roll(1, 16);
+
+		auto specialOf = [](int generation, int index) { return static_cast<SpecialMisket>((generation + index) % 5); };
+		auto isActiveOf = [](int generation, int index) { return (generation + index) % 7 != 0; };
+
+		Table table(rowCount, columnCount, { 0, 1 });
+		auto fill = [&](int generation)
+		{
+			for (int index = 0; index < rowCount * columnCount; ++index)
+			{
+				table.Set(index / columnCount, index % columnCount, generation + index);
+				table.SetSpecial(index / columnCount, index % columnCount, specialOf(generation, index));
+				table.SetActive(index / columnCount, index % columnCount, isActiveOf(generation, index));
+			}
+		};
+
+		// Two slots more than the readers, so no publish is skipped
+		FranticMatch::SnapshotPublisher<int> publisher(readerCount + 2);
+		fill(1);
+		bool ok = publisher.Publish(table);
+
+		std::atomic<bool> stop = false;
+		std::atomic<size_t> readCount = 0;
+		std::atomic<size_t> failureCount = 0;
+		{
+			std::vector<std::jthread> readers;
+			for (int reader = 0; reader < readerCount; ++reader)
+			{
+				readers.emplace_back([&]
+					{
+						std::uint64_t lastEpoch = 0;
+						while (!stop.load())
+						{
+							const auto snapshot = publisher.Acquire();
+							const int generation = snapshot.Get(0, 0);
+							bool readOk = snapshot.GetEpoch() >= lastEpoch && snapshot.GetEpoch() == static_cast<std::uint64_t>(generation)
+								&& snapshot.GetRowCount() == rowCount && snapshot.GetColumnCount() == columnCount;
+
+							for (int row = 0; readOk && row < rowCount; ++row)
+							{
+								const std::span<const int> rowSpan = snapshot.GetRowSpan(row);
+								for (int col = 0; readOk && col < columnCount; ++col)
+								{
+									const int index = row * columnCount + col;
+									readOk = rowSpan[col] == generation + index && *(snapshot.GetColumnView(col).begin() + row) == generation + index
+										&& snapshot.GetSpecial(row, col) == specialOf(generation, index) && snapshot.IsActive(row, col) == isActiveOf(generation, index);
+								}
+							}
+
+							lastEpoch = snapshot.GetEpoch();
+							failureCount += !readOk;
+							++readCount;
+						}
+					});
+			}
+
+			// Let every reader in before the stream starts
+			while (readCount.load() < readerCount)
+			{
+				std::this_thread::yield();
+			}
+
+			for (int generation = 2; generation <= publishCount; ++generation)
+			{
+				fill(generation);
+				stats.engineMs += TimeMs([&] { ok = publisher.Publish(table) && ok; });
+			}
+
+			stop = true;
+		}
+
+		ok = ok && failureCount == 0 && publisher.GetLatestEpoch() == publishCount;
+
+		stats.caseCount += readCount;
+		stats.failureCount += failureCount + !ok;
+		return ok;
+	}
+
+	/// <summary>
+	/// Fill a SessionHost over two blocks of sessions, play a valid and an invalid move on every session, and recycle a few.
+	/// Unknown and destroyed IDs must be refused, every move must leave a settled board, and a recycled session must get a new table.
+	/// </summary>
+	bool CheckSessionHost(unsigned int seed, KernelStats& stats)
+	{
+		using Host = FranticMatch::SessionHost<int>;
+		constexpr size_t sessionCount = Host::SESSION_BLOCK_SIZE + 8;
+		constexpr int recycledCount = 16;
+
+		Table::SeedRandom(seed);
+		Host host(8, 8, { 1, 8, 15, 22, 29 }, 3, sessionCount, 2);
+
+		// Moves of one session run in order, so the results of every session are in the order they were submitted
+		std::mutex resultMutex;
+		std::vector<std::vector<bool>> results(sessionCount);
+		std::atomic<size_t> failureCount = 0;
+		host.SetMoveCallback([&](Host::SessionId id, Table& table, const Host::MoveResult& result)
+			{
+				failureCount += !table.FindMatchGroups().empty() || !table.HasAnyValidMove() || result.valid != (result.clearedCount > 0);
+
+				std::lock_guard lock(resultMutex);
+				results[id].push_back(result.valid);
+			});
+
+		auto isNewBoard = [](const Table& table)
+		{
+			bool isFresh = table.GetGravity() == Table::Gravity::Down && table.GetSpawnWeights().empty()
+				&& table.FindMatchGroups().empty() && table.HasAnyValidMove();
+			for (int index = 0; isFresh && index < 8 * 8; ++index)
+			{
+				isFresh = table.IsActive(index / 8, index % 8) && table.GetSpecial(index / 8, index % 8) == SpecialMisket::None;
+			}
+			return isFresh;
+		};
+
+		std::vector<Host::SessionId> ids;
+		for (Host::SessionId id = host.CreateSession(); id != Host::INVALID_SESSION; id = host.CreateSession())
+		{
+			ids.push_back(id);
+		}
+
+		bool ok = ids.size() == sessionCount && host.GetSessionCount() == sessionCount
+			&& !host.SubmitMove(Host::INVALID_SESSION, MisketPosition(0, 0), MisketPosition(0, 1))
+			&& host.GetTable(Host::INVALID_SESSION) == nullptr && host.GetTable(static_cast<Host::SessionId>(sessionCount)) == nullptr;
+
+		host.DestroySession(Host::INVALID_SESSION);
+		ok = ok && host.GetSessionCount() == sessionCount;
+
+		stats.engineMs += TimeMs([&]
+			{
+				for (const Host::SessionId id : ids)
+				{
+					Table& table = *host.GetTable(id);
+					ok = ok && isNewBoard(table);
+
+					MisketPosition first;
+					MisketPosition second;
+					ok = ok && table.FindValidMove(first, second)
+						&& host.SubmitMove(id, first, second)
+						&& host.SubmitMove(id, MisketPosition(0, 0), MisketPosition(7, 7));
+				}
+				host.WaitIdle();
+			});
+
+		for (const Host::SessionId id : ids)
+		{
+			ok = ok && results[id] == std::vector<bool> { true, false };
+		}
+
+		// Leave some settings behind, the next game on the session must not get them
+		std::vector<std::pmr::memory_resource*> resources;
+		for (int i = 0; i < recycledCount; ++i)
+		{
+			Table& table = *host.GetTable(ids[i]);
+			table.SetGravity(Table::Gravity::Up);
+			table.SetActive(0, 0, false);
+			table.SetSpawnWeight(0, 0.0);
+			table.EnableMoveTracking();
+			resources.push_back(table.GetMemoryResource());
+
+			host.DestroySession(ids[i]);
+			host.DestroySession(ids[i]);
+			ok = ok && !host.SubmitMove(ids[i], MisketPosition(0, 0), MisketPosition(0, 1));
+		}
+		ok = ok && host.GetSessionCount() == sessionCount - recycledCount;
+
+		for (int i = 0; i < recycledCount; ++i)
+		{
+			const Host::SessionId id = host.CreateSession();
+			const auto recycled = std::ranges::find(ids.begin(), ids.begin() + recycledCount, id);
+			ok = ok && recycled != ids.begin() + recycledCount && isNewBoard(*host.GetTable(id))
+				&& host.GetTable(id)->GetMemoryResource() == resources[recycled - ids.begin()];
+		}
+		ok = ok && host.CreateSession() == Host::INVALID_SESSION && host.GetSessionCount() == sessionCount;
+
+		stats.caseCount += sessionCount;
+		stats.failureCount += failureCount + !ok;
+		return ok && failureCount == 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t caseCount = argc > 1 ? std::stoul(argv[1]) : 2000;
+	const unsigned int seed = argc > 2 ? std::stoul(argv[2]) : 2025;
+
+	KernelStats findStats { "FindMatchGroups" };
+	KernelStats packedStats { "FindPackedMatchGroups" };
+	KernelStats lazyStats { "EnumerateMatchGroups" };
+	KernelStats parallelStats { "FindMatchGroupsParallel" };
+	KernelStats bandStats { "Parallel bands" };
+	KernelStats packedTableStats { "PackedTable::FindMatchGroups" };
+	KernelStats popStats { "PopMiskets" };
+	KernelStats randomiseStats { "Randomise" };
+	KernelStats torusMatchStats { "TorusTopology matches" };
+	KernelStats torusMoveStats { "TorusTopology valid moves" };
+	KernelStats hexMatchStats { "HexTopology matches" };
+	KernelStats hexMoveStats { "HexTopology valid moves" };
+	KernelStats packStats { "LevelPack round trip" };
+	KernelStats diffStats { "Diff" };
+	KernelStats copyStats { "Table copy" };
+	KernelStats resolveStats { "ResolveMatchGroups" };
+	KernelStats eventStats { "Board events" };
+	KernelStats refillStats { "Refill previews" };
+	KernelStats weightStats { "Spawn weights" };
+	KernelStats dirtyStats { "FindDirtyMatchGroups" };
+	KernelStats reshuffleStats { "Reshuffle" };
+	KernelStats trackingStats { "Move tracking" };
+	KernelStats snapshotStats { "SnapshotPublisher reads" };
+	KernelStats hostStats { "SessionHost sessions" };
+
+	const std::string packPath = (std::filesystem::temp_directory_path() / "FranticMatch_OracleCheck.fmlp").string();
+
+	std::cout << "FranticMatch oracle check\n";
+	std::cout << "Cases: " << caseCount << ", first seed: " << seed << "\n\n";
+
+	size_t failedCaseCount = 0;
+	for (size_t i = 0; i < caseCount; ++i)
+	{
+		const Case c = MakeCase(seed + static_cast<unsigned int>(i));
+		std::mt19937 gen(c.seed);
+
+		std::vector<int> possibleValues;
+		for (int colour = 0; colour < c.colourCount; ++colour)
+		{
+			possibleValues.push_back(colour * 7 + 1);
+		}
+
+		// Randomise uses the table's own length, and a length of 2 leaves few boards without matches
+		const unsigned int tableMatchLength = std::max(c.minMatchLength, 3u);
+		Table table(c.rowCount, c.columnCount, possibleValues, tableMatchLength);
+		FillTable(table, c, possibleValues, gen);
+
+		// Every 20th seed also gets a board split into bands, they are slow to check
+		const bool matchesOk = CheckFindMatchGroups(table, c, findStats, packedStats, lazyStats, parallelStats)
+			&& CheckPackedTable(table, c, possibleValues, packedTableStats)
+			&& (c.seed % 20 != 0 || CheckParallelBands(c, possibleValues, bandStats));
+		const bool popOk = CheckPopMiskets(table, c, possibleValues, gen, popStats);
+		// Re-rolling the matches of a two colour board rarely ends
+		const bool randomiseOk = c.colourCount < 3 || CheckRandomise(table, tableMatchLength, possibleValues, gen, randomiseStats);
+		const bool topologyOk = CheckTopology<FranticMatch::TorusTopology>(c, possibleValues, gen, torusMatchStats, torusMoveStats)
+			& CheckTopology<FranticMatch::HexTopology>(c, possibleValues, gen, hexMatchStats, hexMoveStats);
+		const bool packOk = CheckLevelPack(table, c, gen, packPath, packStats);
+		const bool diffOk = CheckDiff(table, c, possibleValues, gen, diffStats);
+		const bool copyOk = CheckCopy(table, c, copyStats);
+
+		// Filled again, so the moves below start with matches and special miskets
+		FillTable(table, c, possibleValues, gen);
+		const bool resolveOk = CheckResolveMatchGroups(table, c, possibleValues, gen, resolveStats);
+		// Special miskets on the big boards set off long chains, they are slow to play
+		const bool eventsOk = c.rowCount * c.columnCount > 24 * 24 || CheckEvents(table, c, gen, eventStats);
+		const bool refillsOk = CheckRefills(table, c, gen, refillStats);
+		const bool weightsOk = CheckSpawnWeights(table, c, possibleValues, gen, weightStats);
+		const bool dirtyOk = CheckDirtyMatchGroups(table, c, possibleValues, gen, dirtyStats);
+		const bool reshuffleOk = CheckReshuffle(table, c, possibleValues, reshuffleStats);
+		// Counting valid moves is slow on the big boards
+		const bool trackingOk = c.rowCount * c.columnCount > 12 * 12 || CheckMoveTracking(table, c, gen, trackingStats);
+
+		if (!(matchesOk && popOk && randomiseOk && topologyOk && packOk && diffOk && copyOk
+			&& resolveOk && eventsOk && refillsOk && weightsOk && dirtyOk && reshuffleOk && trackingOk))
+		{
+			if (failedCaseCount++ < 10)
+			{
+				std::cout << "Mismatch in"
+					<< (matchesOk ? "" : " FindMatchGroups")
+					<< (popOk ? "" : " PopMiskets")
+					<< (randomiseOk ? "" : " Randomise")
+					<< (topologyOk ? "" : " Topology")
+					<< (packOk ? "" : " LevelPack")
+					<< (diffOk ? "" : " Diff")
+					<< (copyOk ? "" : " Copy")
+					<< (resolveOk ? "" : " ResolveMatchGroups")
+					<< (eventsOk ? "" : " Events")
+					<< (refillsOk ? "" : " Refills")
+					<< (weightsOk ? "" : " SpawnWeights")
+					<< (dirtyOk ? "" : " FindDirtyMatchGroups")
+					<< (reshuffleOk ? "" : " Reshuffle")
+					<< (trackingOk ? "" : " MoveTracking")
+					<< ", " << Describe(c) << "\n";
+			}
+		}
+	}
+
+	std::filesystem::remove(packPath);
+
+	if (!CheckSnapshotPublisher(seed, snapshotStats) && failedCaseCount++ < 10)
+		std::cout << "Mismatch in SnapshotPublisher, seed " << seed << "\n";
+
+	if (!CheckSessionHost(seed, hostStats) && failedCaseCount++ < 10)
+		std::cout << "Mismatch in SessionHost, seed " << seed << "\n";
+
+	if (failedCaseCount > 0)
+		std::cout << "\n";
+
+	std::cout << std::setw(30) << std::left << "Kernel" << std::right
+		<< std::setw(8) << "Cases"
+		<< std::setw(10) << "Failed"
+		<< std::setw(14) << "Oracle (ms)"
+		<< std::setw(14) << "Engine (ms)"
+		<< std::setw(12) << "Speed-up" << "\n";
+
+	for (const KernelStats* stats : { &findStats, &packedStats, &lazyStats, &parallelStats, &bandStats, &packedTableStats, &popStats, &randomiseStats,
+		&torusMatchStats, &torusMoveStats, &hexMatchStats, &hexMoveStats, &packStats, &diffStats, &copyStats,
+		&resolveStats, &eventStats, &refillStats, &weightStats, &dirtyStats, &reshuffleStats, &trackingStats, &snapshotStats, &hostStats })
+	{
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::setw(30) << std::left << stats->name << std::right
+			<< std::setw(8) << stats->caseCount
+			<< std::setw(10) << stats->failureCount
+			<< std::setw(14) << stats->oracleMs
+			<< std::setw(14) << stats->engineMs;
+
+		// Round trips, the publisher and the host have no reference version to time
+		if (stats->oracleMs > 0.0 && stats->engineMs > 0.0)
+			std::cout << std::setw(11) << stats->oracleMs / stats->engineMs << "x\n";
+		else
+			std::cout << std::setw(12) << "-" << "\n";
+	}
+
+	std::cout << "\n" << (failedCaseCount == 0 ? "All cases match." : std::to_string(failedCaseCount) + " cases failed.") << "\n";
+	return failedCaseCount == 0 ? 0 : 1;
+}
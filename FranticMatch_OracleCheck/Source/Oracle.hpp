@@ -0,0 +1,614 @@
+// FranticDreamer 2025
+#pragma once
+
+// Reference implementations of the engine kernels.
+//
+// These are the plain versions of FindMatchGroups, PopMiskets, ResolveMatchGroups and Randomise,
+// and of the match scan and valid moves on other topologies,
+// written to be obviously right rather than fast.
+// They work on a copy of the board, so they never share code with the engine they check.
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <utility>
+
+#include "FranticMatch/FranticMatch.hpp"
+
+namespace Oracle
+{
+	using FranticMatch::MisketPosition;
+	using FranticMatch::SpecialMisket;
+
+	using MatchGroup = std::vector<MisketPosition>;
+	using MatchGroups = std::vector<MatchGroup>;
+
+	/// <summary>
+	/// A plain copy of a table, read through its public interface.
+	/// </summary>
+	template <typename T, typename S = FranticMatch::Scalar>
+	struct Board
+	{
+		using Table = FranticMatch::Table<T, S>;
+
+		S rowCount = 0;
+		S columnCount = 0;
+		typename Table::Gravity gravity = Table::Gravity::Down;
+
+		// Row-major, like the table
+		std::vector<T> values;
+		std::vector<SpecialMisket> specials;
+		std::vector<bool> active;
+
+		/// <summary>
+		/// Copy a table, on any topology.
+		/// </summary>
+		template <typename AnyTable>
+		static Board Capture(const AnyTable& table)
+		{
+			Board board;
+			board.rowCount = table.GetRowCount();
+			board.columnCount = table.GetColumnCount();
+			board.gravity = static_cast<typename Table::Gravity>(table.GetGravity());
+
+			for (S row = 0; row < board.rowCount; ++row)
+			{
+				for (S col = 0; col < board.columnCount; ++col)
+				{
+					board.values.push_back(table.Get(row, col));
+					board.specials.push_back(table.GetSpecial(row, col));
+					board.active.push_back(table.IsActive(row, col));
+				}
+			}
+
+			return board;
+		}
+
+		bool CheckBounds(S row, S column) const
+		{
+			return row >= 0 && row < rowCount && column >= 0 && column < columnCount;
+		}
+
+		S Index(S row, S column) const
+		{
+			return row * columnCount + column;
+		}
+
+		/// <summary>
+		/// Cells of a lane, from the edge miskets fall to.
+		/// Lanes are columns for vertical gravity, rows for horizontal gravity.
+		/// </summary>
+		std::vector<S> GetLane(S lane) const
+		{
+			std::vector<S> cells;
+			switch (gravity)
+			{
+			case Table::Gravity::Up:
+				for (S row = 0; row < rowCount; ++row)
+					cells.push_back(Index(row, lane));
+				break;
+			case Table::Gravity::Left:
+				for (S col = 0; col < columnCount; ++col)
+					cells.push_back(Index(lane, col));
+				break;
+			case Table::Gravity::Right:
+				for (S col = columnCount - 1; col >= 0; --col)
+					cells.push_back(Index(lane, col));
+				break;
+			case Table::Gravity::Down:
+			default:
+				for (S row = rowCount - 1; row >= 0; --row)
+					cells.push_back(Index(row, lane));
+				break;
+			}
+			return cells;
+		}
+
+		S GetLaneCount() const
+		{
+			return (gravity == Table::Gravity::Left || gravity == Table::Gravity::Right) ? rowCount : columnCount;
+		}
+	};
+
+	/// <summary>
+	/// Find every run of at least minMatchLength equal, active miskets.
+	/// Holes end runs.
+	/// </summary>
+	/// <remarks>
+	/// Lines are walked one cell at a time, with a bounds check on every step.
+	/// Groups come in the engine's order: rows, then columns,
+	/// then Top-Left to Bottom-Right diagonals and Top-Right to Bottom-Left ones, each by its first cell along the top and side edges.
+	/// </remarks>
+	template <typename T, typename S>
+	MatchGroups FindMatchGroups(const Board<T, S>& board, unsigned int minMatchLength, typename Board<T, S>::Table::MatchDirections matchDirections)
+	{
+		MatchGroups matchGroups;
+
+		auto scanLine = [&](S row, S column, S dRow, S dCol)
+		{
+			MatchGroup run;
+
+			auto flushRun = [&]()
+			{
+				if (!run.empty() && run.size() >= minMatchLength)
+					matchGroups.push_back(run);
+				run.clear();
+			};
+
+			for (; board.CheckBounds(row, column); row += dRow, column += dCol)
+			{
+				const S index = board.Index(row, column);
+				if (!board.active[index])
+				{
+					flushRun();
+					continue;
+				}
+
+				if (!run.empty() && !(board.values[board.Index(run.front().row, run.front().column)] == board.values[index]))
+				{
+					flushRun();
+				}
+				run.push_back(MisketPosition(row, column));
+			}
+
+			flushRun();
+		};
+
+		if (matchDirections.horizontal)
+		{
+			for (S row = 0; row < board.rowCount; ++row)
+				scanLine(row, 0, 0, 1);
+		}
+
+		if (matchDirections.vertical)
+		{
+			for (S col = 0; col < board.columnCount; ++col)
+				scanLine(0, col, 1, 0);
+		}
+
+		if (matchDirections.diagonal)
+		{
+			for (S row = 0; row < board.rowCount; ++row)
+				scanLine(row, 0, 1, 1);
+			for (S col = 1; col < board.columnCount; ++col)
+				scanLine(0, col, 1, 1);
+
+			for (S row = 0; row < board.rowCount; ++row)
+				scanLine(row, board.columnCount - 1, 1, -1);
+			for (S col = board.columnCount - 2; col >= 0; --col)
+				scanLine(0, col, 1, -1);
+		}
+
+		return matchGroups;
+	}
+
+	/// <summary>
+	/// Pop miskets and collapse the lanes towards the gravity edge.
+	/// Positions out of bounds and holes are ignored.
+	/// </summary>
+	/// <returns>The cells to spawn new miskets at. Their values are left as they were.</returns>
+	template <typename T, typename S>
+	std::vector<bool> PopMiskets(Board<T, S>& board, const std::vector<MisketPosition>& positions)
+	{
+		std::vector<bool> popped(board.values.size(), false);
+		for (const auto& pos : positions)
+		{
+			if (board.CheckBounds(pos.row, pos.column))
+				popped[board.Index(pos.row, pos.column)] = true;
+		}
+
+		std::vector<bool> spawned(board.values.size(), false);
+		for (S lane = 0; lane < board.GetLaneCount(); ++lane)
+		{
+			const std::vector<S> cells = board.GetLane(lane);
+
+			// Survivors, nearest to the gravity edge first
+			std::vector<T> values;
+			std::vector<SpecialMisket> specials;
+			for (const S index : cells)
+			{
+				if (board.active[index] && !popped[index])
+				{
+					values.push_back(board.values[index]);
+					specials.push_back(board.specials[index]);
+				}
+			}
+
+			// Fill the active cells from the edge, the rest of them get new miskets
+			size_t next = 0;
+			for (const S index : cells)
+			{
+				if (!board.active[index])
+					continue;
+
+				if (next < values.size())
+				{
+					board.values[index] = values[next];
+					board.specials[index] = specials[next];
+					++next;
+				}
+				else
+				{
+					board.specials[index] = SpecialMisket::None;
+					spawned[index] = true;
+				}
+			}
+		}
+
+		return spawned;
+	}
+
+	/// <summary>
+	/// What a cascade step cleared and created, like the engine's ClearResult.
+	/// </summary>
+	struct ClearResult
+	{
+		/// <summary>
+		/// Cleared cells, in row-major order.
+		/// </summary>
+		std::vector<MisketPosition> cleared;
+		std::vector<std::pair<MisketPosition, SpecialMisket>> created;
+		size_t triggeredCount = 0;
+
+		/// <summary>
+		/// The cells to spawn new miskets at, see PopMiskets.
+		/// </summary>
+		std::vector<bool> spawned;
+	};
+
+	/// <summary>
+	/// Resolve one cascade step: place the special miskets the groups make, set off every special misket
+	/// that gets cleared, then pop the cleared cells.
+	/// </summary>
+	/// <remarks>
+	/// Groups of 5 or more make colour bombs, then two unused groups sharing a misket make a bomb there,
+	/// then unused groups of 4 make a clearer across them.
+	/// A special misket goes on the moved misket if it is in the group, otherwise on the middle one, unless the cell has one already.
+	/// Special miskets hit by another one go off too, until nothing new is hit.
+	/// </remarks>
+	template <typename T, typename S>
+	ClearResult ResolveMatchGroups(Board<T, S>& board, const MatchGroups& matchGroups, const std::vector<MisketPosition>& movedPositions)
+	{
+		ClearResult result;
+
+		auto place = [&](MisketPosition pos, SpecialMisket special)
+		{
+			if (std::ranges::find(result.created, pos, &std::pair<MisketPosition, SpecialMisket>::first) == result.created.end())
+				result.created.emplace_back(pos, special);
+		};
+
+		auto anchorOf = [&](const MatchGroup& group)
+		{
+			for (const auto& pos : group)
+			{
+				if (std::ranges::find(movedPositions, pos) != movedPositions.end())
+					return pos;
+			}
+			return group[group.size() / 2];
+		};
+
+		std::vector<bool> used(matchGroups.size(), false);
+		for (size_t g = 0; g < matchGroups.size(); ++g)
+		{
+			if (matchGroups[g].size() >= 5)
+			{
+				used[g] = true;
+				place(anchorOf(matchGroups[g]), SpecialMisket::ColourBomb);
+			}
+		}
+
+		// A misket belongs to the first group that has it
+		std::vector<size_t> owners(board.values.size(), matchGroups.size());
+		for (size_t g = matchGroups.size(); g-- > 0;)
+		{
+			for (const auto& pos : matchGroups[g])
+				owners[board.Index(pos.row, pos.column)] = g;
+		}
+
+		for (size_t g = 0; g < matchGroups.size(); ++g)
+		{
+			for (const auto& pos : matchGroups[g])
+			{
+				const size_t owner = owners[board.Index(pos.row, pos.column)];
+				if (owner < g && !used[owner] && !used[g])
+				{
+					used[owner] = true;
+					used[g] = true;
+					place(pos, SpecialMisket::Bomb);
+				}
+			}
+		}
+
+		for (size_t g = 0; g < matchGroups.size(); ++g)
+		{
+			const MatchGroup& group = matchGroups[g];
+			if (!used[g] && group.size() == 4)
+				place(anchorOf(group), group[0].row == group[1].row ? SpecialMisket::ColumnClearer : SpecialMisket::RowClearer);
+		}
+
+		// Cells still to clear, and what they set off
+		std::vector<bool> marked(board.values.size(), false);
+		std::vector<S> toClear;
+		for (const auto& group : matchGroups)
+		{
+			for (const auto& pos : group)
+				toClear.push_back(board.Index(pos.row, pos.column));
+		}
+
+		while (!toClear.empty())
+		{
+			const S index = toClear.back();
+			toClear.pop_back();
+			if (marked[index] || !board.active[index])
+				continue;
+
+			marked[index] = true;
+			const S row = index / board.columnCount;
+			const S col = index % board.columnCount;
+
+			switch (board.specials[index])
+			{
+			case SpecialMisket::RowClearer:
+				for (S other = 0; other < board.columnCount; ++other)
+					toClear.push_back(board.Index(row, other));
+				break;
+
+			case SpecialMisket::ColumnClearer:
+				for (S other = 0; other < board.rowCount; ++other)
+					toClear.push_back(board.Index(other, col));
+				break;
+
+			case SpecialMisket::Bomb:
+				for (S otherRow = row - 1; otherRow <= row + 1; ++otherRow)
+				{
+					for (S otherCol = col - 1; otherCol <= col + 1; ++otherCol)
+					{
+						if (board.CheckBounds(otherRow, otherCol))
+							toClear.push_back(board.Index(otherRow, otherCol));
+					}
+				}
+				break;
+
+			case SpecialMisket::ColourBomb:
+				for (S other = 0; other < static_cast<S>(board.values.size()); ++other)
+				{
+					if (board.values[other] == board.values[index])
+						toClear.push_back(other);
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		for (size_t index = 0; index < board.values.size(); ++index)
+		{
+			result.triggeredCount += marked[index] && board.specials[index] != SpecialMisket::None;
+		}
+
+		// New special miskets stay on the board
+		for (const auto& [pos, special] : result.created)
+		{
+			marked[board.Index(pos.row, pos.column)] = false;
+			board.specials[board.Index(pos.row, pos.column)] = special;
+		}
+
+		for (S index = 0; index < static_cast<S>(board.values.size()); ++index)
+		{
+			if (marked[index])
+				result.cleared.push_back(MisketPosition(index / board.columnCount, index % board.columnCount));
+		}
+
+		result.spawned = PopMiskets(board, result.cleared);
+		return result;
+	}
+
+	/// <summary>
+	/// Fill the active cells with random miskets, then re-roll matched miskets until there are no matches.
+	/// Special miskets are removed.
+	/// </summary>
+	template <typename T, typename S>
+	void Randomise(Board<T, S>& board, const std::vector<T>& possibleValues, unsigned int minMatchLength, std::mt19937& randomGen)
+	{
+		std::uniform_int_distribution<size_t> dis(0, possibleValues.size() - 1);
+
+		for (size_t index = 0; index < board.values.size(); ++index)
+		{
+			board.specials[index] = SpecialMisket::None;
+			if (board.active[index])
+				board.values[index] = possibleValues[dis(randomGen)];
+		}
+
+		for (MatchGroups matchGroups = FindMatchGroups(board, minMatchLength, {}); !matchGroups.empty(); matchGroups = FindMatchGroups(board, minMatchLength, {}))
+		{
+			for (const auto& group : matchGroups)
+			{
+				for (const auto& pos : group)
+				{
+					board.values[board.Index(pos.row, pos.column)] = possibleValues[dis(randomGen)];
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Is an axis of a topology switched on by the match directions?
+	/// </summary>
+	template <typename MatchDirections>
+	bool IsAxisEnabled(FranticMatch::MatchAxis axis, MatchDirections matchDirections)
+	{
+		switch (axis)
+		{
+		case FranticMatch::MatchAxis::Horizontal:	return matchDirections.horizontal;
+		case FranticMatch::MatchAxis::Vertical:		return matchDirections.vertical;
+		default:									return matchDirections.diagonal;
+		}
+	}
+
+	/// <summary>
+	/// Find every run of at least minMatchLength equal, active miskets along the lines of a topology.
+	/// </summary>
+	/// <remarks>
+	/// Lines are walked with Topology::Step, one cell at a time, without the engine's line tables.
+	/// A line that comes back to its first cell is a cycle. Its walk starts at a misket that doesn't continue the run
+	/// of the one before it, so runs over the seam are found whole. A cycle of one run is one group.
+	/// Groups are in no particular order.
+	/// </remarks>
+	template <typename Topology, typename T, typename S, typename MatchDirections>
+	MatchGroups FindLineMatchGroups(const Board<T, S>& board, unsigned int minMatchLength, MatchDirections matchDirections)
+	{
+		MatchGroups matchGroups;
+		const S cellCount = board.rowCount * board.columnCount;
+
+		auto continues = [&](S index, S before)
+		{
+			return board.active[index] && board.active[before] && board.values[index] == board.values[before];
+		};
+
+		for (int axis = 0; axis < Topology::axisCount; ++axis)
+		{
+			if (!IsAxisEnabled(Topology::axes[axis], matchDirections))
+				continue;
+
+			std::vector<bool> walked(cellCount, false);
+			for (S cell = 0; cell < cellCount; ++cell)
+			{
+				if (walked[cell])
+					continue;
+
+				// Walk back to the start of the line, or once round its cycle
+				S row = cell / board.columnCount;
+				S column = cell % board.columnCount;
+				bool isCycle = false;
+				for (;;)
+				{
+					S backRow = row;
+					S backColumn = column;
+					if (!Topology::Step(board.rowCount, board.columnCount, backRow, backColumn, axis, false))
+						break;
+
+					if (board.Index(backRow, backColumn) == cell)
+					{
+						isCycle = true;
+						break;
+					}
+
+					row = backRow;
+					column = backColumn;
+				}
+
+				std::vector<S> line;
+				do
+				{
+					line.push_back(board.Index(row, column));
+					walked[line.back()] = true;
+				} while (Topology::Step(board.rowCount, board.columnCount, row, column, axis, true) && board.Index(row, column) != line.front());
+
+				const size_t length = line.size();
+				if (isCycle)
+				{
+					size_t first = 0;
+					while (first < length && continues(line[first], line[(first + length - 1) % length]))
+						++first;
+
+					if (first == length)
+					{
+						if (length >= minMatchLength)
+						{
+							MatchGroup& group = matchGroups.emplace_back();
+							for (const S index : line)
+								group.push_back(MisketPosition(index / board.columnCount, index % board.columnCount));
+						}
+						continue;
+					}
+
+					std::rotate(line.begin(), line.begin() + first, line.end());
+				}
+
+				MatchGroup run;
+				for (size_t k = 0; k <= length; ++k)
+				{
+					if (k == length || !board.active[line[k]] || (!run.empty() && !continues(line[k], line[k - 1])))
+					{
+						if (!run.empty() && run.size() >= minMatchLength)
+							matchGroups.push_back(run);
+						run.clear();
+					}
+
+					if (k < length && board.active[line[k]])
+						run.push_back(MisketPosition(line[k] / board.columnCount, line[k] % board.columnCount));
+				}
+			}
+		}
+
+		return matchGroups;
+	}
+
+	/// <summary>
+	/// Are two cells next to each other along an enabled axis of a topology?
+	/// </summary>
+	template <typename Topology, typename T, typename S, typename MatchDirections>
+	bool AreNeighbours(const Board<T, S>& board, S index, S other, MatchDirections matchDirections)
+	{
+		for (int axis = 0; axis < Topology::axisCount; ++axis)
+		{
+			if (!IsAxisEnabled(Topology::axes[axis], matchDirections))
+				continue;
+
+			for (const bool forward : { true, false })
+			{
+				S row = index / board.columnCount;
+				S column = index % board.columnCount;
+				if (Topology::Step(board.rowCount, board.columnCount, row, column, axis, forward) && board.Index(row, column) == other)
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+	/// <summary>
+	/// Count the valid swaps on a topology: every cell with its next one along every enabled axis,
+	/// both active and different, swapped, and the board scanned again for a group holding one of them.
+	/// </summary>
+	template <typename Topology, typename T, typename S, typename MatchDirections>
+	S CountValidMoves(const Board<T, S>& board, unsigned int minMatchLength, MatchDirections matchDirections)
+	{
+		Board<T, S> swapped = board;
+		S count = 0;
+
+		for (S index = 0; index < static_cast<S>(board.values.size()); ++index)
+		{
+			for (int axis = 0; axis < Topology::axisCount; ++axis)
+			{
+				S row = index / board.columnCount;
+				S column = index % board.columnCount;
+				if (!IsAxisEnabled(Topology::axes[axis], matchDirections) || !Topology::Step(board.rowCount, board.columnCount, row, column, axis, true))
+					continue;
+
+				const S other = board.Index(row, column);
+				if (!board.active[index] || !board.active[other] || board.values[index] == board.values[other])
+					continue;
+
+				std::swap(swapped.values[index], swapped.values[other]);
+				for (const MatchGroup& group : FindLineMatchGroups<Topology>(swapped, minMatchLength, matchDirections))
+				{
+					const bool holdsSwapped = std::ranges::any_of(group, [&](const MisketPosition& pos)
+						{
+							return board.Index(pos.row, pos.column) == index || board.Index(pos.row, pos.column) == other;
+						});
+
+					if (holdsSwapped)
+					{
+						++count;
+						break;
+					}
+				}
+				std::swap(swapped.values[index], swapped.values[other]);
+			}
+		}
+
+		return count;
+	}
+}
@@ -23,6 +23,15 @@ FranticMisketGame::Game::Game(FranticMatch::Scalar rowCount, FranticMatch::Scala
 
 	matchTable = FranticMatch::Table<ColourfulMisket>(rowCount, columnCount, possibleValues, 3u);
 	matchTable.Randomise(true);
+
+	// Dead board checks after every cascade only look at the changed cells
+	matchTable.EnableMoveTracking();
+
+	// A random board can still be dead from the start
+	if (!matchTable.HasAnyValidMove())
+	{
+		matchTable.Reshuffle();
+	}
 }
 
 bool FranticMisketGame::Game::MainMenu()
@@ -145,6 +154,15 @@ void FranticMisketGame::Game::PrintTable() const
 			//std::wostringstream oss;
 			//oss << GetMisketDisplay(misket);
 			std::wstring cell = std::wstring(GetMisketSymbol(misket));
+
+			// Special miskets are shown with their own symbol, in their colour
+			const std::wstring_view specialSymbol = GetSpecialSymbol(matchTable.GetSpecial(row, col));
+			if (!specialSymbol.empty())
+			{
+				std::wcout << std::wstring(cellWidth - specialSymbol.length(), ' ') << GetColourCode(misket) << specialSymbol << CN_CLR_RESET;
+				continue;
+			}
+
 			std::wcout << std::wstring(cellWidth - cell.length(), ' ') << GetMisketDisplay(misket);
 			
 			/*
@@ -170,6 +188,18 @@ std::wstring FranticMisketGame::Game::GetColumnLabel(FranticMatch::Scalar index)
 	return label;
 }
 
+std::wstring_view FranticMisketGame::Game::GetSpecialSymbol(FranticMatch::SpecialMisket special) const
+{
+	switch (special)
+	{
+	case FranticMatch::SpecialMisket::RowClearer:		return L"-";
+	case FranticMatch::SpecialMisket::ColumnClearer:	return L"|";
+	case FranticMatch::SpecialMisket::Bomb:				return L"*";
+	case FranticMatch::SpecialMisket::ColourBomb:		return L"@";
+	default: return L"";
+	}
+}
+
 void FranticMisketGame::Game::PrintMatches() const
 {
 	std::wcout << "\nMatches:\n";
@@ -379,29 +409,6 @@ FranticMisketGame::Game::InputAction FranticMisketGame::Game::SwapMiskets(bool s
 			return InputAction::None;
 		}
 
-		// TODO: There should be no invalid misket positions here.
-		// Sometimes, matching function returns invalid positions, -1 as row or column.
-		// I couldn't get an exact reproduction of this bug.
-		// This needs a fix.
-		// Code below is a workaround for that:
-		//
-		// Check if there are any invalid positions
-		// If there, we have to invalidate that match group, and remove it from the list
-		// This is a bit of a hack, but until a fix, let's do this
-		for (size_t i = 0; i < matches.size(); ++i)
-		{
-			for (const auto& pos : matches[i])
-			{
-				if (!IsValidMisketPosition(pos))
-				{
-					//std::wcout << L"Invalid Misket position: (" << pos.row + 1 << L", " << GetColumnLabel(pos.column) << L")\n";
-					matches.erase(matches.begin() + i);
-					--i;
-					break;
-				}
-			}
-		}
-
 		// Matches found! Now, let's pop'em! Recursively!
 
 		// This looks a bit weird
@@ -424,23 +431,32 @@ FranticMisketGame::Game::InputAction FranticMisketGame::Game::SwapMiskets(bool s
 			CN_CLR_RESET
 		);
 
+		// Special miskets are created where the player moved
+		std::vector<FranticMatch::MisketPosition> movedMiskets = { primarySelectedMisket, secondarySelectedMisket };
+
 		primarySelectedMisket = INVALID_MISKET;
 		secondarySelectedMisket = INVALID_MISKET;
 	
+		// The swap scanned the whole board, so the cascade only rescans the lines it changes
+		matchTable.ClearDirtyLines();
+
 		// Keep popping matches until there are no more matches
 		while (!matches.empty())
 		{
+			auto result = matchTable.ResolveMatchGroups(matches, movedMiskets);
+
 			// Calculate the score
-			for (const auto& match : matches)
-			{
-				for (const auto& misket : match)
-				{
-					AddMatchScore(1);
-				}
-			}
+			AddMatchScore(result.cleared.size());
 
-			matchTable.PopMisketMatchGroups(matches);
-			matches = matchTable.FindMatchGroups();
+			movedMiskets.clear();
+			matches = matchTable.FindDirtyMatchGroups();
+		}
+
+		// Don't let the player get stuck on a dead board
+		if (!matchTable.HasAnyValidMove())
+		{
+			matchTable.Reshuffle();
+			infoInstruction = std::wstring(CN_CLR_YELLOW) + L"No moves left! Miskets are reshuffled.\n\n" + std::wstring(CN_CLR_RESET);
 		}
 
 		return selectSwap ? InputAction::SelectSwap : InputAction::Swap;
@@ -168,6 +168,13 @@ namespace FranticMisketGame
 		/// <returns>The label for the column.</returns>
 		std::wstring GetColumnLabel(FranticMatch::Scalar index) const;
 
+		/// <summary>
+		/// Get the symbol for a special misket.
+		/// </summary>
+		/// <param name="special">The special type of the misket.</param>
+		/// <returns>The symbol, or an empty string for regular miskets.</returns>
+		std::wstring_view GetSpecialSymbol(FranticMatch::SpecialMisket special) const;
+
 		// Debug
 		void PrintMatches() const;
 